@@ -32,8 +32,13 @@
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <boost/tokenizer.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <functional>
 #include <cmath>
 #include <cstddef>
+#include <sstream>
 
 
 template <class T, class M>
@@ -51,12 +56,25 @@ public:
   typedef boost::numeric::ublas::mapped_vector_of_mapped_vector<T, boost::numeric::ublas::row_major>  operator_matrix_type;
 
   DiagMatrix (const alps::ProcessList& , const boost::filesystem::path&,bool delay_construct=false);
+  DiagMatrix (const alps::ProcessList& , const alps::Parameters&,bool delay_construct=false);
 
   void dostep();
 
   void perform_measurements();
   
   std::size_t dimension() const { return this->alps::hamiltonian_matrix<M>::dimension();}
+
+protected:
+  // write output of a sector, one message at a time if sectors are done in parallel
+  void report(std::ostream& os, std::string const& text) const
+  {
+    if (output_mutex_) {
+      boost::mutex::scoped_lock lock(*output_mutex_);
+      os << text;
+    }
+    else
+      os << text;
+  }
   
 private:
   typedef std::pair<std::string,std::string> string_pair;
@@ -64,9 +82,25 @@ private:
   typedef boost::tuple<half_integer_type,half_integer_type,half_integer_type> half_integer_tuple;
   typedef std::vector<std::pair<string_pair,half_integer_tuple> > QNRangeType;
 
+  struct sector_type {
+    alps::Parameters parms;
+    std::vector<string_pair> quantumnumbers;
+    std::size_t dimension;
+    // the basis, if it was built before the sector is diagonalized
+    boost::shared_ptr<typename alps::hamiltonian_matrix<M>::basis_type> basis;
+  };
+  class sector_runner;
+
   void build_subspaces(const std::string&);
+  std::vector<sector_type> enumerate_sectors();
+  void do_sector(sector_type const&);
+  bool do_sectors_parallel(std::vector<sector_type>&, alps::Parameters const&, std::size_t);
   
   virtual void do_subspace() =0;
+
+  // create an independent task diagonalizing sectors in another thread,
+  // or return 0 if the sectors have to be done one after the other
+  virtual DiagMatrix* make_sector_worker(alps::Parameters const&) const { return 0; }
   
   virtual std::vector<value_type> calculate(operator_matrix_type const&) const =0;
   
@@ -78,12 +112,17 @@ private:
   
   template <class Op, class D> 
   std::vector<value_type> calculate(Op const& op, std::pair<D,D>  const&) const;
+
+  bool calculate_correlations(std::string const&, std::string const&, boost::multi_array<std::vector<value_type>,2>&) const;
+  virtual std::size_t num_eigenvectors() const =0;
+  virtual void eigenvector(std::size_t, std::vector<value_type>&) const =0;
   
   void print() const;
   virtual void print_eigenvectors(std::ostream& os) const=0;
 
   std::vector<unsigned int> multiplicities_;    
   QNRangeType ranges_;
+  boost::mutex* output_mutex_;
 };
 
 
@@ -91,6 +130,17 @@ template <class T, class M>
 DiagMatrix<T,M>::DiagMatrix(const alps::ProcessList& where , const boost::filesystem::path& p, bool delay_construct) 
     : alps::scheduler::DiagTask<T>(where,p,delay_construct)
     , alps::hamiltonian_matrix<M>(this->get_parameters())
+    , output_mutex_(0)
+{ 
+  if (this->calc_averages())
+    multiplicities_ = this->distance_multiplicities();
+}
+
+template <class T, class M>
+DiagMatrix<T,M>::DiagMatrix(const alps::ProcessList& where , const alps::Parameters& p, bool delay_construct) 
+    : alps::scheduler::DiagTask<T>(where,p,delay_construct)
+    , alps::hamiltonian_matrix<M>(this->get_parameters())
+    , output_mutex_(0)
 { 
   if (this->calc_averages())
     multiplicities_ = this->distance_multiplicities();
@@ -101,6 +151,35 @@ void DiagMatrix<T,M>::dostep()
 {
   if (this->finished()) 
     return;
+  alps::Parameters p(this->alps::scheduler::Task::parms);
+  std::vector<sector_type> sectors = enumerate_sectors();
+  int num_threads = this->alps::scheduler::Task::parms.value_or_default("SECTOR_THREADS",1);
+  if (num_threads < 2 || sectors.size() < 2 || !do_sectors_parallel(sectors,p,num_threads))
+    for (typename std::vector<sector_type>::const_iterator it=sectors.begin();it!=sectors.end();++it)
+      do_sector(*it);
+  this->finish();
+}
+
+
+template <class T, class M>
+void DiagMatrix<T,M>::do_sector(sector_type const& sector) 
+{
+  this->alps::scheduler::Task::parms = sector.parms;
+  this->set_parameters(sector.parms);
+  if (sector.basis)
+    this->adopt_basis(*sector.basis);
+  if (this->dimension()) {
+    this->quantumnumbervalues_.push_back(sector.quantumnumbers);
+    // get spectrum
+    do_subspace();
+  }
+}
+
+
+template <class T, class M>
+std::vector<typename DiagMatrix<T,M>::sector_type> DiagMatrix<T,M>::enumerate_sectors() 
+{
+  std::vector<sector_type> sectors;
   build_subspaces(this->alps::scheduler::Task::parms["CONSERVED_QUANTUMNUMBERS"]);
   std::vector<half_integer_type> indices(ranges_.size());
   std::vector<std::string> momenta;
@@ -126,12 +205,11 @@ void DiagMatrix<T,M>::dostep()
       this->alps::scheduler::Task::parms["TOTAL_MOMENTUM"]=momenta[ik];
     if (this->alps::scheduler::Task::parms.defined("TOTAL_MOMENTUM") && loop_momenta)
       qns.push_back(std::make_pair(std::string("TOTAL_MOMENTUM"),momenta[ik]));
-    this->set_parameters(this->alps::scheduler::Task::parms);
-    if (this->dimension()) {
-      this->quantumnumbervalues_.push_back(qns);
-      // get spectrum
-      do_subspace();
-    }
+    sector_type sector;
+    sector.parms = this->alps::scheduler::Task::parms;
+    sector.quantumnumbers = qns;
+    sector.dimension = 0;
+    sectors.push_back(sector);
     
     // increment indices
     int j=0;
@@ -148,7 +226,110 @@ void DiagMatrix<T,M>::dostep()
     }
     done = (indices.size()==0 ? ik==0 : j==indices.size());
   } while (!done);
-  this->finish();
+  return sectors;
+}
+
+
+// diagonalizes the sectors taken from a shared list in one worker thread
+template <class T, class M>
+class DiagMatrix<T,M>::sector_runner
+{
+public:
+  sector_runner(DiagMatrix& worker, std::vector<sector_type> const& sectors, std::vector<std::size_t> const& order,
+                std::size_t& next, std::vector<std::size_t>& result, boost::mutex& mutex, std::string& error)
+    : worker_(worker), sectors_(sectors), order_(order), next_(next), result_(result), mutex_(mutex), error_(error) {}
+
+  void operator()()
+  {
+    // every sector reseeds the disorder with DISORDER_SEED; drawing from a
+    // generator of its own, each thread then sees the same disorder as a
+    // serial run
+    alps::Disorder::thread_generator disorder;
+    while (true) {
+      std::size_t k;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        if (next_ == order_.size() || !error_.empty())
+          return;
+        k = order_[next_++];
+      }
+      try {
+        std::size_t n = worker_.eigenvalues_.size();
+        worker_.do_sector(sectors_[k]);
+        if (worker_.eigenvalues_.size() > n)
+          result_[k] = n;
+      }
+      catch (std::exception& exc) {
+        boost::mutex::scoped_lock lock(mutex_);
+        error_ = exc.what();
+      }
+    }
+  }
+
+private:
+  DiagMatrix& worker_;
+  std::vector<sector_type> const& sectors_;
+  std::vector<std::size_t> const& order_;
+  std::size_t& next_;
+  std::vector<std::size_t>& result_;
+  boost::mutex& mutex_;
+  std::string& error_;
+};
+
+
+template <class T, class M>
+bool DiagMatrix<T,M>::do_sectors_parallel(std::vector<sector_type>& sectors, alps::Parameters const& p, std::size_t num_threads)
+{
+  // the cost of a sector grows with its dimension: start with the largest
+  // sectors so that the small ones fill the gaps at the end. The basis built
+  // to get the dimension is handed to the worker diagonalizing the sector.
+  std::vector<std::pair<std::size_t,std::size_t> > cost;
+  for (std::size_t k=0;k<sectors.size();++k) {
+    this->set_parameters(sectors[k].parms);
+    sectors[k].dimension = this->dimension();
+    if (sectors[k].dimension) {
+      sectors[k].basis.reset(new typename alps::hamiltonian_matrix<M>::basis_type);
+      this->release_basis(*sectors[k].basis);
+      cost.push_back(std::make_pair(sectors[k].dimension,k));
+    }
+  }
+  std::stable_sort(cost.begin(),cost.end(),std::greater<std::pair<std::size_t,std::size_t> >());
+  std::vector<std::size_t> order;
+  for (std::size_t i=0;i<cost.size();++i)
+    order.push_back(cost[i].second);
+  num_threads = std::min(num_threads,order.size());
+
+  boost::mutex mutex;
+  std::vector<boost::shared_ptr<DiagMatrix> > workers;
+  for (std::size_t t=0;t<num_threads;++t) {
+    DiagMatrix* w = make_sector_worker(p);
+    if (!w)
+      return false;
+    w->output_mutex_ = &mutex;
+    workers.push_back(boost::shared_ptr<DiagMatrix>(w));
+  }
+
+  std::cerr << "Diagonalizing " << order.size() << " sectors using " << num_threads << " threads\n";
+  std::size_t next=0;
+  std::string error;
+  std::vector<std::vector<std::size_t> > result(num_threads,std::vector<std::size_t>(sectors.size(),std::size_t(-1)));
+  boost::thread_group threads;
+  for (std::size_t t=0;t<num_threads;++t)
+    threads.create_thread(sector_runner(*workers[t],sectors,order,next,result[t],mutex,error));
+  threads.join_all();
+  if (!error.empty())
+    boost::throw_exception(std::runtime_error(error));
+
+  // collect the results in the order of the sectors
+  for (std::size_t k=0;k<sectors.size();++k)
+    for (std::size_t t=0;t<num_threads;++t)
+      if (result[t][k] != std::size_t(-1)) {
+        this->quantumnumbervalues_.push_back(sectors[k].quantumnumbers);
+        this->eigenvalues_.push_back(workers[t]->eigenvalues_[result[t][k]]);
+        this->measurements_.push_back(workers[t]->measurements_[result[t][k]]);
+      }
+  this->alps::scheduler::Task::parms = sectors.back().parms;
+  return true;
 }
 
 
@@ -192,13 +373,15 @@ void DiagMatrix<T,M>::build_subspaces(const std::string& quantumnumbers)
 template <class T, class M>
 void DiagMatrix<T,M>::print() const
 {
-  std::cout << "------------------------------------------------------------------------------------------\n";
-  std::cout << "Eigenvectors for the sector with parameters";
-  std::cout << this->get_parameters();
-  std::cout << "\n\nBasis:\n";
-  this->print_basis(std::cout);
-  std::cout << "\n\nVectors:\n";
-  this->print_eigenvectors(std::cout);
+  std::ostringstream out;
+  out << "------------------------------------------------------------------------------------------\n";
+  out << "Eigenvectors for the sector with parameters";
+  out << this->get_parameters();
+  out << "\n\nBasis:\n";
+  this->print_basis(out);
+  out << "\n\nVectors:\n";
+  this->print_eigenvectors(out);
+  report(std::cout,out.str());
 }
 
 
@@ -249,13 +432,17 @@ void DiagMatrix<T,M>::perform_measurements()
     typedef std::pair<std::string,std::pair<std::string,std::string> > string_string_pair_pair;
     BOOST_FOREACH (string_string_pair_pair const& ex, this->correlation_expressions) {
       //std::cerr << "Evaluating " << ex.first << "\n";
+      boost::multi_array<std::vector<value_type>,2> corrs;
+      bool batched = calculate_correlations(ex.second.first,ex.second.second,corrs);
       std::vector<bool> done(this->num_distances(),false);
       for (site_iterator sit1=this->sites().first; sit1!=this->sites().second ; ++sit1) {
         for (site_iterator sit2=this->sites().first; sit2!=this->sites().second ; ++sit2) {
           std::size_t d = alps::scheduler::DiagTask<T>::distance(*sit1,*sit2);
           if (!done[d] || this->uses_translation_invariance()) {
             std::vector<value_type> av;
-            if (*sit1 == *sit2) {
+            if (batched)
+              av = corrs[*sit1][*sit2];
+            else if (*sit1 == *sit2) {
               alps::SiteOperator op(ex.second.first+"(i)*"+ex.second.second+"(i)","i");
               this->substitute_operators(op,this->alps::scheduler::Task::parms);
               av = calculate(op,*sit1);
@@ -283,19 +470,22 @@ void DiagMatrix<T,M>::perform_measurements()
     // calculate structure factor
     BOOST_FOREACH (string_string_pair_pair const& ex, this->structurefactor_expressions) {
       //std::cerr << "Evaluating " << ex.first << "\n";
-      boost::multi_array<std::vector<value_type>,2> corrs(boost::extents[this->num_sites()][this->num_sites()]);
-      for (site_iterator sit1=this->sites().first; sit1!=this->sites().second ; ++sit1)
-        for (site_iterator sit2=this->sites().first; sit2!=this->sites().second ; ++sit2)
-          if (*sit1 == *sit2) {
-            alps::SiteOperator op(ex.second.first+"(i)*"+ex.second.second+"(i)","i");
-            this->substitute_operators(op,this->alps::scheduler::Task::parms);
-            corrs[*sit1][*sit2] = calculate(op,*sit1);
-          }
-          else {
-            alps::BondOperator op(ex.second.first+"(i)*"+ex.second.second+"(j)","i","j");
-            this->substitute_operators(op,this->alps::scheduler::Task::parms);
-              corrs[*sit1][*sit2] = calculate(op,std::make_pair(*sit1,*sit2));
-          }
+      boost::multi_array<std::vector<value_type>,2> corrs;
+      if (!calculate_correlations(ex.second.first,ex.second.second,corrs)) {
+        corrs.resize(boost::extents[this->num_sites()][this->num_sites()]);
+        for (site_iterator sit1=this->sites().first; sit1!=this->sites().second ; ++sit1)
+          for (site_iterator sit2=this->sites().first; sit2!=this->sites().second ; ++sit2)
+            if (*sit1 == *sit2) {
+              alps::SiteOperator op(ex.second.first+"(i)*"+ex.second.second+"(i)","i");
+              this->substitute_operators(op,this->alps::scheduler::Task::parms);
+              corrs[*sit1][*sit2] = calculate(op,*sit1);
+            }
+            else {
+              alps::BondOperator op(ex.second.first+"(i)*"+ex.second.second+"(j)","i","j");
+              this->substitute_operators(op,this->alps::scheduler::Task::parms);
+                corrs[*sit1][*sit2] = calculate(op,std::make_pair(*sit1,*sit2));
+            }
+      }
       
       // do Fourier-transformed emasurements
       for (typename alps::graph_helper<>::momentum_iterator mit=this->momenta().first; mit != this->momenta().second; ++mit) {
@@ -328,6 +518,98 @@ void DiagMatrix<T,M>::perform_measurements()
 }
 
 
+// Calculates <A(i) B(j)> for all pairs of sites in one sweep over each
+// eigenvector. Instead of building the matrix of every two-site operator,
+// the single-site operators are applied to the eigenvector and the
+// correlations are scalar products <A(i)^dagger psi | B(j) psi>. This is
+// not possible with translation symmetry, where A(i) psi leaves the
+// momentum sector, nor for fermionic operators, which need the
+// Jordan-Wigner string between the sites. Returns false in these cases.
+template <class T, class M>
+bool DiagMatrix<T,M>::calculate_correlations(std::string const& name1, std::string const& name2, 
+                                             boost::multi_array<std::vector<value_type>,2>& corrs) const
+{
+  typedef alps::hamiltonian_matrix<M> hamiltonian_type;
+  using alps::numeric::conj;
+  if (this->uses_translation_invariance() || 
+      !this->alps::scheduler::Task::parms.value_or_default("BATCHED_CORRELATIONS",true))
+    return false;
+
+  // check for fermionic signs on one pair of sites for each pair of site types
+  alps::BondOperator bondop(name1+"(i)*"+name2+"(j)","i","j");
+  this->substitute_operators(bondop,this->alps::scheduler::Task::parms);
+  std::map<unsigned int,site_descriptor> representatives;
+  for (site_iterator sit=this->sites().first; sit!=this->sites().second ; ++sit)
+    representatives.insert(std::make_pair(static_cast<unsigned int>(this->site_type(*sit)),*sit));
+  typedef typename std::map<unsigned int,site_descriptor>::const_iterator rep_iterator;
+  for (rep_iterator r1=representatives.begin(); r1!=representatives.end(); ++r1)
+    for (rep_iterator r2=representatives.begin(); r2!=representatives.end(); ++r2) {
+      alps::multi_array<std::pair<value_type,bool>,4> mat = hamiltonian_type::local_matrix(bondop,r1->second,r2->second);
+      for (std::pair<value_type,bool> const* p=mat.data(); p!=mat.data()+mat.num_elements(); ++p)
+        if (p->second && alps::numeric::is_nonzero(p->first))
+          return false;
+    }
+
+  alps::SiteOperator op1(name1+"(i)","i");
+  alps::SiteOperator op2(name2+"(i)","i");
+  this->substitute_operators(op1,this->alps::scheduler::Task::parms);
+  this->substitute_operators(op2,this->alps::scheduler::Task::parms);
+  std::size_t num_sites = this->num_sites();
+  std::size_t dim = this->dimension();
+
+  // local matrices of A(i)^dagger and B(j)
+  std::vector<boost::multi_array<value_type,2> > adjoint1;
+  std::vector<boost::multi_array<value_type,2> > mat2;
+  for (site_iterator sit=this->sites().first; sit!=this->sites().second ; ++sit) {
+    alps::multi_array<value_type,2> m = hamiltonian_type::local_matrix(op1,*sit);
+    boost::multi_array<value_type,2> a(boost::extents[m.shape()[1]][m.shape()[0]]);
+    for (std::size_t i=0;i<m.shape()[0];++i)
+      for (std::size_t j=0;j<m.shape()[1];++j)
+        a[j][i] = conj(m[i][j]);
+    adjoint1.push_back(a);
+    mat2.push_back(hamiltonian_type::local_matrix(op2,*sit));
+  }
+
+  std::size_t num_vectors = num_eigenvectors();
+  corrs.resize(boost::extents[num_sites][num_sites]);
+  for (std::size_t i=0;i<num_sites;++i)
+    for (std::size_t j=0;j<num_sites;++j)
+      corrs[i][j].resize(num_vectors);
+
+  // B(j) psi is kept for a block of sites j at a time and A(i)^dagger psi for
+  // one site i, so that block+1 vectors of the dimension of the sector are
+  // needed instead of one per site. A(i)^dagger psi is recomputed once per
+  // block, which costs about as much as the scalar products with the block.
+  std::size_t block = this->alps::scheduler::Task::parms.value_or_default("CORRELATION_BLOCK_SIZE",8);
+  block = std::max<std::size_t>(1,std::min(block,num_sites));
+  std::vector<site_descriptor> sites(this->sites().first,this->sites().second);
+  std::vector<value_type> psi;
+  std::vector<value_type> left(dim);
+  std::vector<std::vector<value_type> > right(block,std::vector<value_type>(dim));
+  for (std::size_t k=0;k<num_vectors;++k) {
+    eigenvector(k,psi);
+    for (std::size_t j0=0;j0<num_sites;j0+=block) {
+      std::size_t nb = std::min(block,num_sites-j0);
+      for (std::size_t b=0;b<nb;++b) {
+        std::fill(right[b].begin(),right[b].end(),value_type(0.));
+        hamiltonian_type::apply_operator(this->states,mat2[sites[j0+b]],sites[j0+b],psi,right[b]);
+      }
+      for (std::size_t i=0;i<num_sites;++i) {
+        std::fill(left.begin(),left.end(),value_type(0.));
+        hamiltonian_type::apply_operator(this->states,adjoint1[sites[i]],sites[i],psi,left);
+        for (std::size_t b=0;b<nb;++b) {
+          value_type sum = 0.;
+          for (std::size_t n=0;n<dim;++n)
+            sum += conj(left[n]) * right[b][n];
+          corrs[sites[i]][sites[j0+b]][k] = sum;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+
 template <class T, class M>
 template <class Op>
 std::vector<T> DiagMatrix<T,M>::calculate(Op const& op) const
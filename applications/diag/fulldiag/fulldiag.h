@@ -79,14 +79,23 @@ public:
   typedef typename super_type::operator_matrix_type operator_matrix_type;
   
   FullDiagMatrix (const alps::ProcessList& where , const boost::filesystem::path& p);
+  FullDiagMatrix (const alps::ProcessList& where , const alps::Parameters& p);
   void evaluate(const alps::Parameters&, const std::string&) const;
   void print_eigenvectors(std::ostream& os) const;
 private:
   magnitude_type groundstate_energy() const;
   void do_subspace();
+  super_type* make_sector_worker(alps::Parameters const& p) const
+  { return new FullDiagMatrix(alps::ProcessList(),p); }
   magnitude_type calculate_averages(MeasurementsPlot<magnitude_type>&) const;
   void write_xml_body(alps::oxstream&, const boost::filesystem::path&,bool) const;
   std::vector<value_type> calculate(operator_matrix_type const& m) const;
+  std::size_t num_eigenvectors() const { return num_cols(this->matrix());}
+  void eigenvector(std::size_t i, std::vector<value_type>& v) const
+  {
+    alps::numeric::column_view<matrix_type const> const c(this->matrix(),i);
+    v.assign(c.begin(),c.end());
+  }
 
   mutable magnitude_type energy;
   mutable magnitude_type free_energy;
@@ -114,6 +123,16 @@ FullDiagMatrix<T>::FullDiagMatrix (const alps::ProcessList& where , const boost:
 { 
   this->construct(); 
 }
+
+template <class T>
+FullDiagMatrix<T>::FullDiagMatrix (const alps::ProcessList& where , const alps::Parameters& p) 
+ : super_type(where,p,true)
+ , field(0.)
+ , field0(0.) 
+ , have_Conserved(false) 
+{ 
+  this->construct(); 
+}
     
     
 template <class T>
@@ -0,0 +1,194 @@
+/*****************************************************************************
+*
+* ALPS Project Applications
+*
+* Copyright (C) 1994-2013 by Matthias Troyer <troyer@comp-phys.org>
+*
+* This software is part of the ALPS Applications, published under the ALPS
+* Application License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+*
+* You should have received a copy of the ALPS Application License along with
+* the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+/* $Id$ */
+
+#ifndef ALPS_APPLICATIONS_SPARSEDIAG_CSR_MATRIX_H
+#define ALPS_APPLICATIONS_SPARSEDIAG_CSR_MATRIX_H
+
+#include <alps/numeric/is_nonzero.hpp>
+#include <boost/numeric/ublas/matrix_sparse.hpp>
+#include <boost/cstdint.hpp>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// An immutable sparse matrix in compressed sparse row format.
+//
+// The Hamiltonian is assembled in a mapped (node based) matrix, which is
+// convenient for random insertion but slow to multiply with. Once the matrix
+// is complete it can be frozen into this representation, which stores the
+// nonzero elements of each row contiguously and multiplies a vector with
+// one pass over the data, parallelized over rows if OpenMP is enabled.
+
+template <class T>
+class csr_matrix
+{
+public:
+  typedef T value_type;
+  typedef std::size_t size_type;
+  typedef boost::uint32_t index_type;
+
+  csr_matrix() : size1_(0), size2_(0), row_start_(1,0) {}
+
+  // freeze a ublas sparse matrix, dropping explicitly stored zeros
+  template <class M>
+  explicit csr_matrix(M const& m)
+    : size1_(m.size1())
+    , size2_(m.size2())
+    , row_start_(m.size1()+1,0)
+  {
+    if (size2_ > std::numeric_limits<index_type>::max())
+      throw std::runtime_error("matrix dimension too large for csr_matrix");
+    typedef typename M::const_iterator1 row_iterator;
+    typedef typename M::const_iterator2 column_iterator;
+    for (row_iterator it1 = m.begin1(); it1 != m.end1(); ++it1)
+      for (column_iterator it2 = it1.begin(); it2 != it1.end(); ++it2)
+        if (alps::numeric::is_nonzero(value_type(*it2)))
+          ++row_start_[it2.index1()+1];
+    for (size_type i = 0; i < size1_; ++i)
+      row_start_[i+1] += row_start_[i];
+    column_.resize(row_start_[size1_]);
+    value_.resize(row_start_[size1_]);
+    std::vector<size_type> pos(row_start_.begin(),row_start_.end()-1);
+    for (row_iterator it1 = m.begin1(); it1 != m.end1(); ++it1)
+      for (column_iterator it2 = it1.begin(); it2 != it1.end(); ++it2)
+        if (alps::numeric::is_nonzero(value_type(*it2))) {
+          size_type p = pos[it2.index1()]++;
+          column_[p] = it2.index2();
+          value_[p] = *it2;
+        }
+  }
+
+  // freeze a row major mapped_vector_of_mapped_vector, erasing each row of
+  // the mapped matrix as soon as it has been copied. The peak memory is then
+  // that of the mapped matrix plus one row, instead of both representations.
+  // The mapped matrix is left empty.
+  template <class U, class A>
+  void assign_and_clear(boost::numeric::ublas::mapped_vector_of_mapped_vector<U,boost::numeric::ublas::row_major,A>& m)
+  {
+    typedef A row_map_type;
+    typedef typename row_map_type::mapped_type column_map_type;
+    if (m.size2() > std::numeric_limits<index_type>::max())
+      throw std::runtime_error("matrix dimension too large for csr_matrix");
+    size1_ = m.size1();
+    size2_ = m.size2();
+    row_map_type& rows = m.data();
+
+    // count first so that the arrays are allocated exactly once
+    size_type count = 0;
+    for (typename row_map_type::const_iterator it = rows.begin(); it != rows.end() && it->first < size1_; ++it)
+      for (typename column_map_type::const_iterator jt = it->second.begin(); jt != it->second.end(); ++jt)
+        if (alps::numeric::is_nonzero(value_type(jt->second)))
+          ++count;
+    std::vector<size_type>(size1_+1,0).swap(row_start_);
+    std::vector<index_type>().swap(column_);
+    std::vector<value_type>().swap(value_);
+    column_.reserve(count);
+    value_.reserve(count);
+
+    // rows are stored in increasing order; empty rows have no map entry
+    size_type filled = 0;
+    typename row_map_type::iterator it = rows.begin();
+    while (it != rows.end() && it->first < size1_) {
+      while (filled < it->first)
+        row_start_[++filled] = value_.size();
+      for (typename column_map_type::const_iterator jt = it->second.begin(); jt != it->second.end(); ++jt)
+        if (alps::numeric::is_nonzero(value_type(jt->second))) {
+          column_.push_back(jt->first);
+          value_.push_back(jt->second);
+        }
+      row_start_[++filled] = value_.size();
+      rows.erase(it++);
+    }
+    while (filled < size1_)
+      row_start_[++filled] = value_.size();
+    m.clear();
+  }
+
+  size_type size1() const { return size1_; }
+  size_type size2() const { return size2_; }
+  size_type nnz() const { return value_.size(); }
+
+  // bytes used for the matrix elements and index arrays
+  std::size_t memory() const
+  {
+    return row_start_.capacity() * sizeof(size_type) + column_.capacity() * sizeof(index_type)
+         + value_.capacity() * sizeof(value_type);
+  }
+
+  value_type operator()(size_type i, size_type j) const
+  {
+    for (size_type p = row_start_[i]; p != row_start_[i+1]; ++p)
+      if (column_[p] == j)
+        return value_[p];
+    return value_type();
+  }
+
+  // y = A x
+  template <class V, class W>
+  void multiply(V const& x, W& y) const
+  {
+    long const n = size1_;
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < n; ++i) {
+      value_type sum = value_type();
+      for (size_type p = row_start_[i]; p != row_start_[i+1]; ++p)
+        sum += value_[p] * x[column_[p]];
+      y[i] = sum;
+    }
+  }
+
+  void swap(csr_matrix& other)
+  {
+    std::swap(size1_,other.size1_);
+    std::swap(size2_,other.size2_);
+    row_start_.swap(other.row_start_);
+    column_.swap(other.column_);
+    value_.swap(other.value_);
+  }
+
+private:
+  size_type size1_;
+  size_type size2_;
+  std::vector<size_type> row_start_;
+  std::vector<index_type> column_;
+  std::vector<value_type> value_;
+};
+
+namespace ietl {
+
+  template <class T, class V>
+  void mult(csr_matrix<T> const& m, V const& x, V& y)
+  {
+    if (y.size() != m.size1())
+      y.resize(m.size1());
+    m.multiply(x,y);
+  }
+
+}
+
+#endif
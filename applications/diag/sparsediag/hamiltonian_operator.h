@@ -0,0 +1,77 @@
+/*****************************************************************************
+*
+* ALPS Project Applications
+*
+* Copyright (C) 1994-2013 by Matthias Troyer <troyer@comp-phys.org>
+*
+* This software is part of the ALPS Applications, published under the ALPS
+* Application License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+*
+* You should have received a copy of the ALPS Application License along with
+* the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+/* $Id$ */
+
+#ifndef ALPS_APPLICATIONS_SPARSEDIAG_HAMILTONIAN_OPERATOR_H
+#define ALPS_APPLICATIONS_SPARSEDIAG_HAMILTONIAN_OPERATOR_H
+
+#include <algorithm>
+#include <cstddef>
+
+// A matrix-free Hamiltonian for ietl::lanczos.
+//
+// Instead of storing the matrix, every multiplication applies the site and
+// bond terms of the model directly to the vector using the cached local
+// matrices of the hamiltonian_matrix. Only a few Lanczos vectors need to be
+// kept in memory, at the price of recomputing the basis state lookups in
+// each iteration.
+
+template <class H>
+class hamiltonian_operator
+{
+public:
+  typedef std::size_t size_type;
+
+  explicit hamiltonian_operator(H const& h) : h_(h) {}
+
+  size_type size1() const { return h_.dimension(); }
+  size_type size2() const { return h_.dimension(); }
+
+  // y = H x
+  template <class V, class W>
+  void multiply(V const& x, W& y) const
+  {
+    if (y.size() != size1())
+      y.resize(size1());
+    std::fill(y.begin(),y.end(),typename W::value_type());
+    h_.apply_hamiltonian(x,y);
+  }
+
+private:
+  H const& h_;
+};
+
+namespace ietl {
+
+  template <class H, class V>
+  void mult(hamiltonian_operator<H> const& m, V const& x, V& y)
+  {
+    m.multiply(x,y);
+  }
+
+}
+
+#endif
@@ -26,6 +26,8 @@
 /* $Id$ */
 
 #include "../diag.h"
+#include "csr_matrix.h"
+#include "hamiltonian_operator.h"
 #include <alps/numeric/real.hpp>
 #include <boost/numeric/ublas/matrix_sparse.hpp>
 #include <boost/numeric/ublas/io.hpp>
@@ -53,12 +55,21 @@ public:
   typedef typename super_type::operator_matrix_type operator_matrix_type;
   
   SparseDiagMatrix (const alps::ProcessList& where , const boost::filesystem::path& p);
+  SparseDiagMatrix (const alps::ProcessList& where , const alps::Parameters& p);
   void do_subspace();
   void write_xml_body(alps::oxstream&, const boost::filesystem::path&, bool) const;
   void print_eigenvectors(std::ostream& os) const;
 private:
+  super_type* make_sector_worker(alps::Parameters const& p) const
+  { return new SparseDiagMatrix(alps::ProcessList(),p); }
   
+  template <class MATRIX>
+  void diagonalize(MATRIX const& m, mag_vector_type& ev);
+
   std::vector<value_type> calculate(operator_matrix_type const& m) const;
+  std::size_t num_eigenvectors() const { return eigenvectors.size();}
+  void eigenvector(std::size_t i, std::vector<value_type>& v) const
+  { v.assign(eigenvectors[i].begin(),eigenvectors[i].end()); }
   std::vector<vector_type> eigenvectors;
 };
 
@@ -69,6 +80,13 @@ SparseDiagMatrix<T>::SparseDiagMatrix(const alps::ProcessList& where , const boo
   this->construct();
 }
 
+template <class T>
+SparseDiagMatrix<T>::SparseDiagMatrix(const alps::ProcessList& where , const alps::Parameters& p) 
+ : super_type(where,p,true) 
+{ 
+  this->construct();
+}
+
 
 template <class T>
 void SparseDiagMatrix<T>::write_xml_body(alps::oxstream& out, const boost::filesystem::path& p, bool writeallxml) const
@@ -107,50 +125,37 @@ void SparseDiagMatrix<T>::write_xml_body(alps::oxstream& out, const boost::files
 template <class T>
 void SparseDiagMatrix<T>::do_subspace()
 {
-  typedef ietl::vectorspace<vector_type> vectorspace_type;
   using alps::numeric::real;
-  boost::lagged_fibonacci607 generator;
   mag_vector_type ev;
-  this->build();
   if (this->dimension()==0)
     return;
 
-  vectorspace_type vec(this->dimension());
-  ietl::lanczos<matrix_type,vectorspace_type> lanczos(this->matrix(),vec);
-  int n;
-  
   if (this->dimension()>1) {
-    int max_iter = this->get_parameters().value_or_default("MAX_ITERATIONS",std::min(int(10*this->dimension()),1000));  
-    int num_eigenvalues = this->get_parameters().value_or_default("NUMBER_EIGENVALUES",1);
-    ietl::lanczos_iteration_nlowest<double> iter(max_iter,num_eigenvalues);
-    std::cerr << "Starting Lanczos \n";
-    lanczos.calculate_eigenvalues(iter,generator);
-    std::cerr << "Finished Lanczos\n";
-    n=std::min(num_eigenvalues,int(lanczos.eigenvalues().size()));
-    ev.resize(n);
-    for (int i=0;i<n;++i) 
-      ev[i]=lanczos.eigenvalues()[i];
+    std::string format = this->get_parameters().value_or_default("SPARSE_MATRIX_FORMAT","CSR");
+    if (format == "MATRIX_FREE") {
+      // apply the Hamiltonian on the fly, never storing the matrix
+      hamiltonian_operator<alps::hamiltonian_matrix<matrix_type> > h(*this);
+      diagonalize(h,ev);
+    }
+    else if (format == "CSR") {
+      // freeze the assembled matrix, releasing the mapped storage row by row
+      csr_matrix<value_type> m;
+      m.assign_and_clear(this->matrix());
+      matrix_type().swap(this->matrix());
+      std::ostringstream out;
+      out << "Frozen matrix with " << m.nnz() << " nonzero elements in " << m.memory() << " bytes\n";
+      this->report(std::cerr,out.str());
+      diagonalize(m,ev);
+    }
+    else if (format == "MAPPED")
+      diagonalize(this->matrix(),ev);
+    else
+      boost::throw_exception(std::runtime_error("unknown SPARSE_MATRIX_FORMAT " + format));
   }
-  else
-  {
+  else {
     ev.resize(1);
     ev[0]=real(value_type(this->matrix()(0,0)));
-  }
-  if (this->calc_vectors()) {
-    if  (this->dimension()>1) {
-      // calculate eigen vectors
-      ietl::Info<magnitude_type> info; // (m1, m2, ma, eigenvalue, residualm, status).
-  
-      try {
-        eigenvectors.clear();
-        lanczos.eigenvectors(lanczos.eigenvalues().begin(),lanczos.eigenvalues().begin()+n,
-                             std::back_inserter(eigenvectors),info,generator); 
-      }
-      catch (std::runtime_error& e) {
-        std::cout <<"Exception during eigenvector calculation: " <<  e.what() << "\n";
-      }  
-    }
-    else {
+    if (this->calc_vectors()) {
       vector_type v(1);
       v[0]=1.;
       eigenvectors.push_back(v);
@@ -162,6 +167,40 @@ void SparseDiagMatrix<T>::do_subspace()
   this->eigenvalues_.push_back(ev);
 }
 
+template <class T> template <class MATRIX>
+void SparseDiagMatrix<T>::diagonalize(MATRIX const& m, mag_vector_type& ev)
+{
+  typedef ietl::vectorspace<vector_type> vectorspace_type;
+  boost::lagged_fibonacci607 generator;
+
+  vectorspace_type vec(this->dimension());
+  ietl::lanczos<MATRIX,vectorspace_type> lanczos(m,vec);
+  int max_iter = this->get_parameters().value_or_default("MAX_ITERATIONS",std::min(int(10*this->dimension()),1000));  
+  int num_eigenvalues = this->get_parameters().value_or_default("NUMBER_EIGENVALUES",1);
+  ietl::lanczos_iteration_nlowest<double> iter(max_iter,num_eigenvalues);
+  this->report(std::cerr,"Starting Lanczos \n");
+  lanczos.calculate_eigenvalues(iter,generator);
+  this->report(std::cerr,"Finished Lanczos\n");
+  int n=std::min(num_eigenvalues,int(lanczos.eigenvalues().size()));
+  ev.resize(n);
+  for (int i=0;i<n;++i) 
+    ev[i]=lanczos.eigenvalues()[i];
+
+  if (this->calc_vectors()) {
+    // calculate eigen vectors
+    ietl::Info<magnitude_type> info; // (m1, m2, ma, eigenvalue, residualm, status).
+  
+    try {
+      eigenvectors.clear();
+      lanczos.eigenvectors(lanczos.eigenvalues().begin(),lanczos.eigenvalues().begin()+n,
+                           std::back_inserter(eigenvectors),info,generator); 
+    }
+    catch (std::runtime_error& e) {
+      this->report(std::cout,std::string("Exception during eigenvector calculation: ") + e.what() + "\n");
+    }  
+  }
+}
+
 template <class T>
 std::vector<T> SparseDiagMatrix<T>::calculate(operator_matrix_type const& m) const
 {
@@ -75,10 +75,10 @@ private:
   void create_measurements();
   //measure_* functions perform the actual measurements
   void measure_order();
-  void measure_G(std::vector<std::map<double,double> > &F_prefactor);
-  void measure_Gw(std::vector<std::map<double,double> > &F_prefactor);
-  void measure_Gl(std::vector<std::map<double,double> > &F_prefactor);
-  void measure_G2w(std::vector<std::map<double,double> > &F_prefactor);
+  void measure_G(std::vector<prefactor_map_t > &F_prefactor);
+  void measure_Gw(std::vector<prefactor_map_t > &F_prefactor);
+  void measure_Gl(std::vector<prefactor_map_t > &F_prefactor);
+  void measure_G2w(std::vector<prefactor_map_t > &F_prefactor);
   void measure_nn();
   void measure_nnt();
   void measure_nnw();
@@ -184,7 +184,7 @@ private:
   std::vector<double>h2wr;
   std::vector<double>h2wi;
 
-  std::vector<std::map<double,double> > F_prefactor;
+  std::vector<prefactor_map_t > F_prefactor;
 
   //local impurity operator configuration
   local_configuration local_config;
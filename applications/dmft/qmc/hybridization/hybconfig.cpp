@@ -89,22 +89,22 @@ void hybridization_configuration::insert_antisegment(const segment &new_antisegm
   //hybmat_[orbital].rebuild_hyb_matrix(orbital, Delta);
   //std::cout<<clmagenta<<"done after as insert recompute "<<cblack<<std::endl;
 }
-void hybridization_configuration::measure_G(std::vector<std::vector<double> > &G, std::vector<std::vector<double> > &F, const std::vector<std::map<double,double> > &F_prefactor, double sign) const{
+void hybridization_configuration::measure_G(std::vector<std::vector<double> > &G, std::vector<std::vector<double> > &F, const std::vector<prefactor_map_t > &F_prefactor, double sign) const{
   for(std::size_t orbital=0;orbital<hybmat_.size();++orbital){
     hybmat_[orbital].measure_G(G[orbital], F[orbital], F_prefactor[orbital], sign);
   }
 }
-void hybridization_configuration::measure_Gw(std::vector<std::vector<double> > &Gwr, std::vector<std::vector<double> > &Gwi, std::vector<std::vector<double> > &Fwr, std::vector<std::vector<double> > &Fwi, const std::vector<std::map<double,double> > &F_prefactor, double sign) const{
+void hybridization_configuration::measure_Gw(std::vector<std::vector<double> > &Gwr, std::vector<std::vector<double> > &Gwi, std::vector<std::vector<double> > &Fwr, std::vector<std::vector<double> > &Fwi, const std::vector<prefactor_map_t > &F_prefactor, double sign) const{
   for(std::size_t orbital=0;orbital<hybmat_.size();++orbital){
     hybmat_[orbital].measure_Gw(Gwr[orbital], Gwi[orbital], Fwr[orbital], Fwi[orbital], F_prefactor[orbital], sign);
   }
 }
-void hybridization_configuration::measure_G2w(std::vector<std::vector<std::complex<double> > >&G2w, std::vector<std::vector<std::complex<double> > > &F2w, int N_w2, int N_w_aux, const std::vector<std::map<double,double> > &F_prefactor) const{
+void hybridization_configuration::measure_G2w(std::vector<std::vector<std::complex<double> > >&G2w, std::vector<std::vector<std::complex<double> > > &F2w, int N_w2, int N_w_aux, const std::vector<prefactor_map_t > &F_prefactor) const{
   for(std::size_t orbital=0;orbital<hybmat_.size();++orbital){
     hybmat_[orbital].measure_G2w(G2w[orbital], F2w[orbital], N_w2, N_w_aux, F_prefactor[orbital]);
   }
 }
-void hybridization_configuration::measure_Gl(std::vector<std::vector<double> > &Gl, std::vector<std::vector<double> > &Fl, const std::vector<std::map<double,double> > &F_prefactor, double sign) const{
+void hybridization_configuration::measure_Gl(std::vector<std::vector<double> > &Gl, std::vector<std::vector<double> > &Fl, const std::vector<prefactor_map_t > &F_prefactor, double sign) const{
   for(std::size_t orbital=0;orbital<hybmat_.size();++orbital){
     hybmat_[orbital].measure_Gl(Gl[orbital], Fl[orbital], F_prefactor[orbital], sign);
   }
@@ -39,6 +39,7 @@ K_(p){
   n_orbitals_=p["N_ORBITALS"];
 //    std::cerr << "Start ...";
   segments_.resize(n_orbitals_);
+  occupation_sums_.resize(n_orbitals_, std::vector<double>(1, 0.));
   zero_order_orbital_occupied_.resize(n_orbitals_,false);
 //    std::cerr << " done\n";
   use_retarded_interaction_=p.defined("RET_INT_K");
@@ -63,7 +64,7 @@ std::ostream &operator<<(std::ostream &os, const local_configuration &local_conf
     }
     else{
       os<<i<<" ";
-      for(std::set<segment>::const_iterator it=local_conf.segments_[i].begin();it!=local_conf.segments_[i].end();++it){
+      for(segment_container_t::const_iterator it=local_conf.segments_[i].begin();it!=local_conf.segments_[i].end();++it){
         os<<"("<<it->t_start_<<" "<<it->t_end_<<") ";
       }
     }
@@ -89,10 +90,7 @@ double local_configuration::local_weight_change(const segment &seg, int orb, boo
     if(zero_order_orbital_occupied_[i]){
       overlaps[i]=length;
     }else{
-      //find the first segment with time t_start > seg.t_start
-      for(std::set<segment>::const_iterator it=segments_[i].begin(); it != segments_[i].end();++it){
-        overlaps[i]+=segment_overlap(seg, *it);
-      }
+      overlaps[i]=orbital_overlap(seg, i);
     }
     //std::cout<<clmagenta<<"weight of orbital: "<<orb<<" wrt orbital: "<<i<<" is: "<<std::exp(U_(orb,i)*overlaps[i])<<" for overlap: "<<overlaps[i]<<cblack<<std::endl;
     weight*=std::exp(-sgn*U_(orb,i)*overlaps[i]);
@@ -108,7 +106,7 @@ double local_configuration::local_weight_change(const segment &seg, int orb, boo
       retarded_weight=0.;
     }else{
       for(int i=0;i<n_orbitals_;++i){
-        for(std::set<segment>::const_iterator it=segments_[i].begin(); it != segments_[i].end();++it){
+        for(segment_container_t::const_iterator it=segments_[i].begin(); it != segments_[i].end();++it){
           retarded_weight+=sgn*K_.interpolate(seg.t_start_-it->t_start_);
           retarded_weight-=sgn*K_.interpolate(seg.t_start_-it->t_end_);
           retarded_weight-=sgn*K_.interpolate(seg.t_end_-it->t_start_);
@@ -139,7 +137,7 @@ bool local_configuration::has_overlap(const segment &seg,const int orb) {
     return true;
   } else {
     //find the first segment with time t_start > seg.t_start
-    for(std::set<segment>::const_iterator it=segments_[orb].begin(); it !=
+    for(segment_container_t::const_iterator it=segments_[orb].begin(); it !=
         segments_[orb].end();++it) {
       if (segment_overlap(seg, *it)>0.0) return true;
     }
@@ -156,10 +154,41 @@ double local_configuration::segment_overlap(const segment &seg1, const segment &
   double t2=std::min(seg1.t_end_, seg2.t_end_);
   return t2-t1<0?0.:t2-t1;
 }
+//the integral of the occupation of an orbital from 0 to t. Only the segment
+//starting before t needs to be looked at, the lengths of all earlier segments
+//are summed up in occupation_sums_. This is O(log k) in the expansion order.
+double local_configuration::occupation_integral(int orbital, double t) const{
+  const segment_container_t &segments=segments_[orbital];
+  if(segments.size()==0) return 0.;
+  double integral=0.;
+  const segment &last=*(segments.end()-1);
+  if(last.t_start_>last.t_end_) integral+=std::min(t, last.t_end_); //part of the wraparound segment after zero
+  std::size_t k=segments.upper_bound(segment(t, 0.))-segments.begin(); //number of segments starting before t
+  if(k==0) return integral;
+  const segment &current=*(segments.begin()+(k-1));
+  double t_end=current.t_start_>current.t_end_?beta_:current.t_end_;
+  return integral+occupation_sums_[orbital][k-1]+std::min(t, t_end)-current.t_start_;
+}
+//the overlap of a segment with all segments of an orbital, same as the sum of segment_overlap over them.
+double local_configuration::orbital_overlap(const segment &seg, int orbital) const{
+  if(seg.t_start_>seg.t_end_) return occupation_integral(orbital, beta_)-occupation_integral(orbital, seg.t_start_)+occupation_integral(orbital, seg.t_end_);
+  return occupation_integral(orbital, seg.t_end_)-occupation_integral(orbital, seg.t_start_);
+}
+//recompute the summed segment lengths after an orbital has changed. This is
+//linear in the expansion order, like the insertion into the sorted segments.
+void local_configuration::update_occupation_sums(int orbital){
+  std::vector<double> &sums=occupation_sums_[orbital];
+  sums.resize(segments_[orbital].size()+1);
+  std::size_t k=0;
+  for(segment_container_t::const_iterator it=segments_[orbital].begin(); it!=segments_[orbital].end();++it,++k){
+    double length=it->t_end_-it->t_start_;
+    sums[k+1]=sums[k]+(length<0?length+beta_:length);
+  }
+}
 //find the distance to the next segment start (the next creation operator)
 double local_configuration::find_next_segment_start_distance(double time, int orbital){
   if(segments_[orbital].size()==0) return beta_; //no segments present
-  std::set<segment>::const_iterator it=segments_[orbital].upper_bound(segment(time, 0.));
+  segment_container_t::const_iterator it=segments_[orbital].upper_bound(segment(time, 0.));
   if(it==segments_[orbital].end())
     return (beta_-time+segments_[orbital].begin()->t_start_); //wrap around
   return it->t_start_-time;
@@ -174,7 +203,7 @@ double local_configuration::find_next_segment_end_distance(double time, int orbi
     return distance<0?distance+beta_:distance; //single segment present
   }
   //first possibility: like start time, the closest end-time is after this segment
-  std::set<segment>::const_iterator it=segments_[orbital].upper_bound(segment(time, 0.));
+  segment_container_t::const_iterator it=segments_[orbital].upper_bound(segment(time, 0.));
   if(it==segments_[orbital].end()) distance=(segments_[orbital].begin()->t_end_-time); //wrap around to end time
   else distance=it->t_end_-time;
   if(distance<0) distance+=beta_;
@@ -187,6 +216,7 @@ double local_configuration::find_next_segment_end_distance(double time, int orbi
 
 void local_configuration::insert_segment(const segment &new_segment, int orbital){
   segments_[orbital].insert(new_segment);
+  update_occupation_sums(orbital);
   if(!times_set_.insert(new_segment.t_start_).second){std::stringstream s; s<<crank_; throw std::logic_error("rank "+s.str()+": insert segment start time could not be inserted.");}
   if(!times_set_.insert(new_segment.t_end_).second){std::stringstream s; s<<crank_; std::cout<<*this<<std::endl; std::cout<<"inserted segment: "<<new_segment<<"into orbital: "<<orbital<<std::endl; throw std::logic_error("rank "+s.str()+": insert segment end time could not be inserted.");}
 }
@@ -199,7 +229,7 @@ void local_configuration::insert_antisegment(const segment &new_antisegment, int
   }
   //general case: need to find a segment, then split it in two.
   else{
-    std::set<segment>::iterator it=segments_[orbital].upper_bound(new_antisegment);
+    segment_container_t::iterator it=segments_[orbital].upper_bound(new_antisegment);
     if(it==segments_[orbital].begin()) it=segments_[orbital].end(); //wrap around
     it--;
     segment new_later_segment(new_antisegment.t_start_, it->t_end_);
@@ -208,6 +238,7 @@ void local_configuration::insert_antisegment(const segment &new_antisegment, int
     segments_[orbital].insert(new_later_segment);
     segments_[orbital].insert(new_earlier_segment);
   }
+  update_occupation_sums(orbital);
   if(!times_set_.insert(new_antisegment.t_start_).second){std::stringstream s; s<<crank_; throw std::logic_error("rank "+s.str()+": insert antisegment start time could not be inserted.");}
   if(!times_set_.insert(new_antisegment.t_end_).second){std::stringstream s; s<<crank_; throw std::logic_error("rank "+s.str()+": insert antisegment start time could not be inserted.");}
 }
@@ -220,16 +251,18 @@ void local_configuration::remove_antisegment(const segment &new_antisegment, int
   }
   //general case: need to find two segments and merge them
   else{
-    std::set<segment>::iterator it_later=segments_[orbital].find(new_antisegment);
-    std::set<segment>::iterator it_earlier=it_later;
+    segment_container_t::iterator it_later=segments_[orbital].find(new_antisegment);
+    segment_container_t::iterator it_earlier=it_later;
     if(it_earlier==segments_[orbital].begin()) it_earlier=segments_[orbital].end(); //wrap around
     it_earlier--;
     segment new_segment=*it_earlier;
     new_segment.t_end_=it_later->t_end_;
+    //erasing one element moves the ones behind it, so erase the earlier segment by its key
     segments_[orbital].erase(it_later);
-    segments_[orbital].erase(it_earlier);
+    segments_[orbital].erase(new_segment);
     segments_[orbital].insert(new_segment);
   }
+  update_occupation_sums(orbital);
   if(!times_set_.erase(new_antisegment.t_start_)){
     std::cerr<<"in local_configuration::remove_antisegment"<<std::endl;
     std::cerr<<"time to erase was: "<<new_antisegment.t_start_<<std::endl;
@@ -241,7 +274,7 @@ void local_configuration::remove_antisegment(const segment &new_antisegment, int
     std::cerr<<"successfully erased the segment before that. "<<std::endl;
     std::cerr<<"successfully inserted the segment at: (gone.)"<<std::endl;
     std::cerr<<"the times are: "<<std::endl;
-    for (std::set<double>::const_iterator it=times_set_.begin(); it!=times_set_.end();++it){ std::cout<<*it<<" ";} std::cerr<<std::endl;
+    for (boost::container::flat_set<double>::const_iterator it=times_set_.begin(); it!=times_set_.end();++it){ std::cout<<*it<<" ";} std::cerr<<std::endl;
     std::cerr<<std::endl;
     std::cerr<<"in local_configuration::remove_antisegment"<<std::endl;
     std::cerr<<"time to erase was: "<<new_antisegment.t_end_<<std::endl;
@@ -252,9 +285,9 @@ void local_configuration::remove_antisegment(const segment &new_antisegment, int
 }
 
 segment local_configuration::get_segment(int k, int orbital) const{
-  std::set<segment>::const_iterator it= segments_[orbital].begin();
+  segment_container_t::const_iterator it= segments_[orbital].begin();
   if(k>=(int)(segments_[orbital].size())) throw std::logic_error("not enough segments to get this one.");
-  advance(it, k);
+  std::advance(it, k);
   return *it;
 }
 void local_configuration::remove_segment(const segment &new_segment, int orbital){
@@ -262,6 +295,7 @@ void local_configuration::remove_segment(const segment &new_segment, int orbital
   //std::cout<<clmagenta<<"segment to remove: "<<new_segment<<cblack<<std::endl;
   if(segments_[orbital].erase(new_segment)==0) throw std::logic_error("did not find segment to remove!");
   if(segments_[orbital].size()==0) zero_order_orbital_occupied_[orbital]=false;
+  update_occupation_sums(orbital);
   
   if(!times_set_.erase(new_segment.t_start_)){
     std::cerr<<"in local_configuration::remove_segment"<<std::endl;
@@ -296,10 +330,7 @@ double local_configuration::local_energy(const segment &seg, int orb,bool d_mu_o
         if(zero_order_orbital_occupied_[i]){
             overlaps[i]=length;
         }else{
-            //find the first segment with time t_start > seg.t_start
-            for(std::set<segment>::const_iterator it=segments_[i].begin(); it != segments_[i].end();++it){
-                overlaps[i]+=segment_overlap(seg, *it);
-            }
+            overlaps[i]=orbital_overlap(seg, i);
         }
         //std::cout<<clmagenta<<"weight of orbital: "<<orb<<" wrt orbital: "<<i<<" is: "<<std::exp(U_(orb,i)*overlaps[i])<<" for overlap: "<<overlaps[i]<<cblack<<std::endl;
         energy -= U_(orb,i)*overlaps[i];
@@ -315,7 +346,7 @@ double local_configuration::local_energy(const segment &seg, int orb,bool d_mu_o
             retarded_weight=0.;
         }else{
             for(int i=0;i<n_orbitals_;++i){
-                for(std::set<segment>::const_iterator it=segments_[i].begin(); it != segments_[i].end();++it){
+                for(segment_container_t::const_iterator it=segments_[i].begin(); it != segments_[i].end();++it){
                     retarded_weight+=K_.interpolate(seg.t_start_-it->t_start_);
                     retarded_weight-=K_.interpolate(seg.t_start_-it->t_end_);
                     retarded_weight-=K_.interpolate(seg.t_end_-it->t_start_);
@@ -332,8 +363,8 @@ void local_configuration::check_consistency()const {
   for(int i=0;i<n_orbitals_;++i){
     if(order(i)<2) continue; //nothing to check if none or only one segment present
     //std::cout<<"testing orbital: "<<i<<" order: "<<order(i)<<std::endl;
-    for(std::set<segment>::const_iterator it=segments_[i].begin();it!=segments_[i].end();++it){
-      std::set<segment>::const_iterator next_it=it; next_it++;
+    for(segment_container_t::const_iterator it=segments_[i].begin();it!=segments_[i].end();++it){
+      segment_container_t::const_iterator next_it=it; next_it++;
       if(next_it!=segments_[i].end()){
         //std::cout<<"testing it: "<<*it<<" next it: "<<*next_it<<std::endl;
         if(it->t_end_<it->t_start_){
@@ -372,7 +403,7 @@ void local_configuration::check_consistency()const {
  for(int i=0;i<n_orbitals_;++i){
  n_tauprime[i].resize(segments_[i].size());
  int k=0;
- for(std::set<segment>::const_iterator it=segments_[i].begin();it!=segments_[i].end();++it,++k){
+ for(segment_container_t::const_iterator it=segments_[i].begin();it!=segments_[i].end();++it,++k){
  n_tauprime[i][k].resize(n_orbitals_, 0.);
  //      double tauprime=it->t_start_;
  double tauprime=it->t_end_;
@@ -386,7 +417,7 @@ void local_configuration::check_consistency()const {
  continue;
  }else{
  //                    n_tauprime[i][k][j]=0.;
- //           for(std::set<segment>::const_iterator it2=segments_[j].begin();it2!=segments_[j].end();++it2){
+ //           for(segment_container_t::const_iterator it2=segments_[j].begin();it2!=segments_[j].end();++it2){
  //           if(it2->t_end_>it2->t_start_){ //regular segment
  //           if(it2->t_start_<tauprime && tauprime <it2->t_end_){
  //           n_tauprime[i][k][j]=1.;
@@ -397,10 +428,10 @@ void local_configuration::check_consistency()const {
  //           }
  //           }
  //find first segment after tauprime, call it it_after
- std::set<segment>::const_iterator it_after=segments_[j].upper_bound(segment(tauprime,0.)); //this is the segment that starts after tauprime
+ segment_container_t::const_iterator it_after=segments_[j].upper_bound(segment(tauprime,0.)); //this is the segment that starts after tauprime
  if(it_after==segments_[j].end()) it_after=segments_[j].begin();
  //find the segment which is before it_after. call it it_before
- std::set<segment>::const_iterator it_before=it_after;
+ segment_container_t::const_iterator it_before=it_after;
  if(it_before==segments_[j].begin()){ it_before=segments_[j].end(); } it_before--; //this is the segment that has the start time before tauprime
  
  //find out the iterator it overlaps with a segment in this orbital. two cases: either it does not wrap and is just in between, or it wraps and is in between.
@@ -421,7 +452,7 @@ void local_configuration::check_consistency()const {
  for(int i=0;i<n_orbitals_;++i){
  n_tauprime[i].resize(segments_[i].size());
  int k=0;
- for(std::set<segment>::const_iterator it=segments_[i].begin();it!=segments_[i].end();++it,++k){
+ for(segment_container_t::const_iterator it=segments_[i].begin();it!=segments_[i].end();++it,++k){
  n_tauprime[i][k].resize(n_orbitals_, 0.);
  //      double tauprime=it->t_start_;
  double tauprime=it->t_end_;
@@ -440,10 +471,10 @@ double local_configuration::density(int i, double tauprime) const{//density on o
   if(segments_[i].size()==0) return zero_order_orbital_occupied_[i]?1.:0.;
   else{
     //find first segment after tauprime, call it it_after
-    std::set<segment>::const_iterator it_after=segments_[i].upper_bound(segment(tauprime,0.)); //this is the segment that starts after tauprime
+    segment_container_t::const_iterator it_after=segments_[i].upper_bound(segment(tauprime,0.)); //this is the segment that starts after tauprime
     if(it_after==segments_[i].end()) it_after=segments_[i].begin();
     //find the segment which is before it_after. call it it_before
-    std::set<segment>::const_iterator it_before=it_after;
+    segment_container_t::const_iterator it_before=it_after;
     if(it_before==segments_[i].begin()){ it_before=segments_[i].end(); } it_before--; //this is the segment that has the start time before tauprime
     
     //find out the iterator it overlaps with a segment in this orbital. two cases: either it does not wrap and is just in between, or it wraps and is in between.
@@ -455,11 +486,11 @@ double local_configuration::density(int i, double tauprime) const{//density on o
 }
 
 
-double local_configuration::interaction_density_integral(std::set<segment>::const_iterator &it_i) const{
+double local_configuration::interaction_density_integral(segment_container_t::const_iterator &it_i) const{
   //for orbital i, compute \sum_j int_0^beta dt U_ret(tau - t) n_j(t) using the primitive K'(tau) of U(tau)=K''(tau)
   double integral=0.0; double sgn;
   for(int j=0; j<n_orbitals_; ++j){
-    for(std::set<segment>::const_iterator it_j=segments_[j].begin(); it_j!=segments_[j].end();++it_j){
+    for(segment_container_t::const_iterator it_j=segments_[j].begin(); it_j!=segments_[j].end();++it_j){
       integral+= K_.interpolate_deriv(it_j->t_end_ - it_i->t_end_) - K_.interpolate_deriv(it_j->t_start_ - it_i->t_end_);
     }
   }
@@ -483,19 +514,21 @@ double local_configuration::interaction_density_integral(std::set<segment>::cons
 //Note also that for the correlator H it *does* make a difference  whether
 //n is coupled the creator or annihilator. To save computations and memory, we
 //evaluate F_prefactor for annihilator times only, in favor of the correlator H.
-void local_configuration::get_F_prefactor(std::vector<std::map<double,double> > &F_prefactor)const{
+void local_configuration::get_F_prefactor(std::vector<prefactor_map_t > &F_prefactor)const{
   for(std::size_t i=0; i<n_orbitals_; ++i) F_prefactor[i].clear();
   //this is F_prefactor[orbital i][segment k in orbital i]
   for(std::size_t i=0;i<n_orbitals_;++i){
-    std::size_t k=0;
-    for(std::set<segment>::const_iterator it=segments_[i].begin(); it!=segments_[i].end();++it,++k){
-      F_prefactor[i][it->t_end_] = 0;
+    F_prefactor[i].reserve(segments_[i].size());
+    for(segment_container_t::const_iterator it=segments_[i].begin(); it!=segments_[i].end();++it){
+      double f=0;
       for(std::size_t j=0; j<n_orbitals_; ++j){
-        F_prefactor[i][it->t_end_] += 0.5*(U_(i,j)+U_(j,i))*density(j,it->t_end_);
+        f += 0.5*(U_(i,j)+U_(j,i))*density(j,it->t_end_);
       }
       if(use_retarded_interaction_){//also contribute for j==i
-          F_prefactor[i][it->t_end_] += interaction_density_integral(it);
+          f += interaction_density_integral(it);
       }
+      //end times are ordered like the start times, except for a wraparound segment
+      F_prefactor[i].insert(it->t_end_>=it->t_start_?F_prefactor[i].end():F_prefactor[i].begin(), std::make_pair(it->t_end_, f));
     }
   }
 }
@@ -33,13 +33,16 @@
 #include"hybint.hpp"
 #include"hybretintfun.hpp"
 #include"hybsegment.hpp"
-#include<set>
+#include<map>
+#include<boost/container/flat_set.hpp>
 #include<vector>
 //this is the class that handles everything in connection with the local
 //impurity operators. It knows about segments, chemical potentials,
 //interactions, and so on.
 
-typedef std::set<segment> segment_container_t;
+//segments and times are kept in sorted arrays: they are traversed far more
+//often than they are changed, and a change only moves a few contiguous elements.
+typedef boost::container::flat_set<segment> segment_container_t;
 typedef std::map<double,int> state_map;
 
 typedef class local_configuration{
@@ -61,7 +64,7 @@ public:
   bool exists(double t) const{ return times_set_.find(t)==times_set_.end()?false:true;}
   bool has_overlap(const segment &seg,const int orb);
   void get_segment_densities(std::vector<std::vector<std::vector<double> > > &n_tauprime)const;
-  void get_F_prefactor(std::vector<std::map<double,double> > &F_prefactor)const;
+  void get_F_prefactor(std::vector<prefactor_map_t > &F_prefactor)const;
   void measure_density(std::vector<double> &densities, double sign) const;
   double segment_density(int i) const;
   double measure_nn(int i, int j) const;
@@ -69,7 +72,7 @@ public:
   void get_density_vectors(std::vector<std::vector<double> > &n_vector) const;
   double density(int i, double tau) const;
   double mu(int orbital) {return mu_[orbital];}
-  double interaction_density_integral(std::set<segment>::const_iterator &it) const;
+  double interaction_density_integral(segment_container_t::const_iterator &it) const;
   void state_map_segment_insert(state_map &states, const segment &s, int state) const;
   void measure_sector_statistics(std::vector<double> &sector_statistics, double sign) const;
   friend std::ostream &operator<<(std::ostream &os, const local_configuration &local_conf);
@@ -81,6 +84,9 @@ public:
 private:
   //private member functions
   double segment_overlap(const segment &seg1, const segment &seg2) const;
+  double occupation_integral(int orbital, double t) const;
+  double orbital_overlap(const segment &seg, int orbital) const;
+  void update_occupation_sums(int orbital);
 
   //private variables
   int crank_;
@@ -91,9 +97,10 @@ private:
   double beta_;
   int n_orbitals_;
   bool use_retarded_interaction_;
-  std::vector<std::set<segment> > segments_;
+  std::vector<segment_container_t> segments_;
+  std::vector<std::vector<double> > occupation_sums_; //occupation_sums_[i][k] is the total length of the first k segments of orbital i
   std::vector<bool > zero_order_orbital_occupied_; //special case for perturbation order zero, where the orbital can either be occupied or empty. True means it is occupied, false is empty.
-  std::set<double> times_set_; //this is a map making sure we don't have any times double, which would otherwise confuse the commutators.
+  boost::container::flat_set<double> times_set_; //this is a map making sure we don't have any times double, which would otherwise confuse the commutators.
 } local_configuration;
 
 std::ostream &operator<<(std::ostream &os, const local_configuration &local_conf);
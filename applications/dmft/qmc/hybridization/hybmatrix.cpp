@@ -100,8 +100,8 @@ void hybmatrix::insert_segment(const segment &new_segment, int orbital){
   }
   
   // add the new segment times:
-  cdagger_index_map_.insert(std::make_pair(new_segment.t_start_, last));
-  c_index_map_      .insert(std::make_pair(new_segment.t_end_  , last));
+  cdagger_index_map_.insert(hyb_map_t::value_type(new_segment.t_start_, last));
+  c_index_map_      .insert(hyb_map_t::value_type(new_segment.t_end_  , last));
   
   //keep track of the wraparound sign
   if(new_segment.t_start_>new_segment.t_end_){
@@ -227,22 +227,14 @@ void hybmatrix::rebuild_ordered_hyb_matrix(int orbital, const hybfun &Delta){
   //std::cout<<*this<<std::endl;
   //std::cout<<clblue<<*(blas_matrix*)this<<cblack<<std::endl;
   //order the times properly
+  //the times stay the same, only the indices change, so they are assigned in place
   int k=0;
-  hyb_map_t::iterator it_bup;
-  for(hyb_map_t::iterator it_end=cdagger_index_map_.begin();it_end != cdagger_index_map_.end();){
-    it_bup=it_end++;
-    std::pair<double,int> new_entry=*it_bup;
-    new_entry.second=k++;
-    cdagger_index_map_.erase(it_bup);
-    cdagger_index_map_.insert(new_entry);
+  for(hyb_map_t::iterator it_end=cdagger_index_map_.begin();it_end != cdagger_index_map_.end();++it_end){
+    it_end->second=k++;
   }
   k=0;
-  for(hyb_map_t::iterator it_start=c_index_map_.begin();it_start != c_index_map_.end();){
-    it_bup=it_start++;
-    std::pair<double,int> new_entry=*it_bup;
-    new_entry.second=((it_bup==c_index_map_.begin()) && (it_bup->first<cdagger_index_map_.begin()->first))?c_index_map_.size()-1:k++;
-    c_index_map_.erase(it_bup);
-    c_index_map_.insert(new_entry);
+  for(hyb_map_t::iterator it_start=c_index_map_.begin();it_start != c_index_map_.end();++it_start){
+    it_start->second=((it_start==c_index_map_.begin()) && (it_start->first<cdagger_index_map_.begin()->first))?c_index_map_.size()-1:k++;
   }  //if we have an overlapping segment we need a permutation sign of -1, otherwise it is 1 in the ordered case.
   if(size()==0){
     permutation_sign_=1.;
@@ -263,7 +255,7 @@ double hybmatrix::full_weight() const{
   //std::cout<<clcyan<<"det: "<<determinant()<<" ps: "<<permutation_sign_<<cblack<<std::endl;
   return determinant()*permutation_sign_;
 }
-void hybmatrix::measure_G(std::vector<double> &G, std::vector<double> &F, const std::map<double,double> &F_prefactor, double sign) const{
+void hybmatrix::measure_G(std::vector<double> &G, std::vector<double> &F, const prefactor_map_t &F_prefactor, double sign) const{
   double N_div_beta=(G.size()-1)/beta_;
   static std::vector<double> cdagger_times(size()); cdagger_times.resize(size());
   static std::vector<double> c_times(size()); c_times.resize(size());
@@ -313,7 +305,7 @@ void hybmatrix::consistency_check() const{
 }
 
 
-void hybmatrix::measure_Gl(std::vector<double> &Gl, std::vector<double> &Fl , const std::map<double,double> &F_prefactor, double sign) const{
+void hybmatrix::measure_Gl(std::vector<double> &Gl, std::vector<double> &Fl , const prefactor_map_t &F_prefactor, double sign) const{
   static std::vector<double> cdagger_times(size()); cdagger_times.resize(size());
   static std::vector<double> c_times(size()); c_times.resize(size());
   static std::vector<std::complex<double> > cdagger_exp(size()); cdagger_exp.resize(size());
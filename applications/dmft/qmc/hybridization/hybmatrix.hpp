@@ -28,7 +28,7 @@
  *****************************************************************************/
 #ifndef HYB_MATRIX
 #define HYB_MATRIX
-#include<map>
+#include<boost/container/flat_map.hpp>
 #include<vector>
 #include "hybsegment.hpp"
 #include "hybfun.hpp"
@@ -37,10 +37,10 @@
 //This is the hybridization matrix class responsible for computing determinant ratios and the like. Derived from a general blas matrix class that can handle elementary blas and lapack operations.
 
 //simple matrix that uses BLAS calls for rank one and matrix vector.
-typedef std::map<double,std::size_t> hyb_map_t;
+typedef boost::container::flat_map<double,std::size_t> hyb_map_t;
 class hybmatrix:public blas_matrix{
 public:
-  hybmatrix(const alps::params &p){ determinant_=1.; determinant_old_=1.; permutation_sign_=1.; beta_=p["BETA"]; measure_g2w_=p["MEASURE_g2w"]|0; measure_h2w_=p["MEASURE_h2w"]|0; }
+  hybmatrix(const alps::params &p){ determinant_=1.; determinant_old_=1.; permutation_sign_=1.; beta_=p["BETA"]; measure_g2w_=p["MEASURE_g2w"]|0; measure_h2w_=p["MEASURE_h2w"]|0; measure_freq_nfft_=p["MEASURE_freq_nfft"]|0; }
   hybmatrix(const hybmatrix &rhs) 
       :blas_matrix(rhs)
       ,cdagger_index_map_(rhs.cdagger_index_map_)
@@ -58,6 +58,7 @@ public:
       ,beta_(rhs.beta_)
       ,measure_g2w_(rhs.measure_g2w_)
       ,measure_h2w_(rhs.measure_h2w_)
+      ,measure_freq_nfft_(rhs.measure_freq_nfft_)
   {}
   ~hybmatrix() {
 //    std::cerr << "Deleting hybmatrix\n";
@@ -70,13 +71,14 @@ public:
   void rebuild_hyb_matrix(int orbital, const hybfun &Delta);
   void rebuild_ordered_hyb_matrix(int orbital, const hybfun &Delta);
   double full_weight() const;
-  void measure_G(std::vector<double> &G, std::vector<double> &F, const std::map<double,double> &F_prefactor, double sign) const;
-  void measure_Gw(std::vector<double> &Gwr, std::vector<double> &Gwi,std::vector<double> &Fwr, std::vector<double> &Fwi, const std::map<double,double> &F_prefactor, double sign) const;
-  void measure_Gw_buffer(std::vector<double> &Gwr, std::vector<double> &Gwi,std::vector<double> &Fwr, std::vector<double> &Fwi, const std::map<double,double> &F_prefactor, double sign) const;
-  void measure_G2w(std::vector<std::complex<double> > &G2w, std::vector<std::complex<double> >&F2w, int N_w2, int N_w_aux, const std::map<double,double> &F_prefactor) const;
-  void measure_Gl(std::vector<double> &Gl, std::vector<double> &Fl, const std::map<double,double> &F_prefactor, double sign) const;
+  void measure_G(std::vector<double> &G, std::vector<double> &F, const prefactor_map_t &F_prefactor, double sign) const;
+  void measure_Gw(std::vector<double> &Gwr, std::vector<double> &Gwi,std::vector<double> &Fwr, std::vector<double> &Fwi, const prefactor_map_t &F_prefactor, double sign) const;
+  void measure_Gw_buffer(std::vector<double> &Gwr, std::vector<double> &Gwi,std::vector<double> &Fwr, std::vector<double> &Fwi, const prefactor_map_t &F_prefactor, double sign) const;
+  void measure_G2w(std::vector<std::complex<double> > &G2w, std::vector<std::complex<double> >&F2w, int N_w2, int N_w_aux, const prefactor_map_t &F_prefactor) const;
+  void measure_Gl(std::vector<double> &Gl, std::vector<double> &Fl, const prefactor_map_t &F_prefactor, double sign) const;
   void consistency_check() const;
 private:
+  void measure_Gw_nfft(std::vector<double> &Gwr, std::vector<double> &Gwi,std::vector<double> &Fwr, std::vector<double> &Fwi, const prefactor_map_t &F_prefactor, double sign) const;
 
   //map of start/end times and their corresponding rows and columns in the matrix.
   hyb_map_t cdagger_index_map_;
@@ -99,6 +101,7 @@ private:
   //physics
   double beta_;
   bool measure_g2w_, measure_h2w_;
+  bool measure_freq_nfft_;
 };
 
 std::ostream &operator<<(std::ostream   &os, const hybmatrix &hyb_mat); 
@@ -29,7 +29,37 @@
 
 #include "hybmatrix.hpp"
 
-void hybmatrix::measure_Gw(std::vector<double> &Gwr, std::vector<double> &Gwi , std::vector<double> &Fwr, std::vector<double> &Fwi , const std::map<double,double> &F_prefactor, double sign) const{
+namespace {
+//in-place discrete Fourier transform a_k = sum_m a_m exp(2 pi i k m/N) for N a power of two (iterative radix-2)
+void fft_positive(std::vector<std::complex<double> > &a){
+  std::size_t N=a.size();
+  for(std::size_t i=1, j=0;i<N;++i){
+    std::size_t bit=N>>1;
+    for(;j&bit;bit>>=1) j^=bit;
+    j^=bit;
+    if(i<j) std::swap(a[i],a[j]);
+  }
+  for(std::size_t len=2;len<=N;len<<=1){
+    std::complex<double> w_len=std::exp(std::complex<double>(0, 2.*M_PI/len));
+    for(std::size_t i=0;i<N;i+=len){
+      std::complex<double> w(1.,0.);
+      for(std::size_t k=0;k<len/2;++k){
+        std::complex<double> u=a[i+k];
+        std::complex<double> v=a[i+k+len/2]*w;
+        a[i+k]=u+v;
+        a[i+k+len/2]=u-v;
+        w*=w_len;
+      }
+    }
+  }
+}
+}
+
+void hybmatrix::measure_Gw(std::vector<double> &Gwr, std::vector<double> &Gwi , std::vector<double> &Fwr, std::vector<double> &Fwi , const prefactor_map_t &F_prefactor, double sign) const{
+  if(measure_freq_nfft_){
+    measure_Gw_nfft(Gwr, Gwi, Fwr, Fwi, F_prefactor, sign);
+    return;
+  }
   static std::vector<double> cdagger_times(size()); cdagger_times.resize(size());
   static std::vector<double> c_times(size()); c_times.resize(size());
   static std::vector<std::complex<double> > cdagger_exp(size()); cdagger_exp.resize(size());
@@ -71,13 +101,99 @@ void hybmatrix::measure_Gw(std::vector<double> &Gwr, std::vector<double> &Gwi ,
 }
 
 
-void hybmatrix::measure_G2w(std::vector<std::complex<double> > &G2w, std::vector<std::complex<double> >&F2w, int N_w2, int N_w_aux, const std::map<double,double> &F_prefactor) const{
+//measures G(iw_n) and F(iw_n) with a non-equispaced FFT, see Greengard and Lee, SIAM Review 46, 443 (2004).
+//each of the k^2 pairs of times is spread onto an oversampled equidistant grid with a Gaussian,
+//the grid is Fourier transformed and the result is divided by the Fourier transform of the Gaussian.
+//this costs O(k^2 M_sp + N_w log N_w) instead of O(k^2 N_w) and is accurate to about 1e-12.
+void hybmatrix::measure_Gw_nfft(std::vector<double> &Gwr, std::vector<double> &Gwi , std::vector<double> &Fwr, std::vector<double> &Fwi , const prefactor_map_t &F_prefactor, double sign) const{
   static std::vector<double> cdagger_times(size()); cdagger_times.resize(size());
   static std::vector<double> c_times(size()); c_times.resize(size());
-  static std::vector<std::complex<double> > c_exp_ini(size()); c_exp_ini.resize(size());
-  static std::vector<std::complex<double> > c_exp_inc(size()); c_exp_inc.resize(size());
-  static std::vector<std::complex<double> > cdagger_exp_ini(size()); cdagger_exp_ini.resize(size());
-  static std::vector<std::complex<double> > cdagger_exp_inc(size()); cdagger_exp_inc.resize(size());
+  static std::vector<std::complex<double> > cdagger_exp(size()); cdagger_exp.resize(size());
+  static std::vector<std::complex<double> > c_exp(size()); c_exp.resize(size());
+  static std::vector<std::complex<double> > G_grid; 
+  static std::vector<std::complex<double> > F_grid; 
+  static std::vector<double> E3;
+  const int N_w=Gwr.size();
+  if(N_w==0) return;
+  const int M_sp=12;                                   //number of grid points on each side of a time the Gaussian is spread to
+  int M_r=32; while(M_r<2*N_w) M_r<<=1;               //oversampled grid, a power of two larger than 2*M_sp for the FFT
+  const double R=M_r/(double)N_w;
+  const double tau=M_PI*M_sp/((double)N_w*N_w*R*(R-0.5)); //width of the Gaussian
+  const double delta=2.*M_PI/M_r;
+  const int h=N_w/2;                                   //frequencies are shifted to n-h to be centered around zero
+  const double w_h=(2*h+1)*M_PI/beta_;
+
+  G_grid.assign(M_r, 0.);
+  F_grid.assign(M_r, 0.);
+  E3.resize(M_sp+1);
+  for(int l=0;l<=M_sp;++l) E3[l]=std::exp(-(l*delta)*(l*delta)/(4.*tau));
+
+  //create map of creator and annihilator times
+  for (hyb_map_t::const_iterator it= c_index_map_.begin(); it != c_index_map_.end(); ++it) {
+    c_times[it->second] = it->first;
+  }
+  for (hyb_map_t::const_iterator it= cdagger_index_map_.begin(); it != cdagger_index_map_.end(); ++it) {
+    cdagger_times[it->second] = it->first;
+  }
+  for(int i=0;i<size();++i){ c_exp      [i]=std::exp(std::complex<double>(0,  w_h*c_times      [i])); }
+  for(int i=0;i<size();++i){ cdagger_exp[i]=std::exp(std::complex<double>(0, -w_h*cdagger_times[i])); }
+
+  //spread -M_ji exp(i w_h (tau_i-tau'_j))/beta at x=(tau_i-tau'_j)/beta mod 1 onto the grid
+  for (int i = 0; i < size(); i++) {
+    //see the note on F_prefactor in measure_Gw
+    double f_pref=(F_prefactor.find(c_times[i]))->second;
+    for (int j = 0; j < size(); j++) {
+      std::complex<double> meas = -operator() (j, i) * sign*c_exp[i]*cdagger_exp[j]/beta_;
+      std::complex<double> fmeas = f_pref*meas;
+      double x = (c_times[i]-cdagger_times[j])/beta_;
+      if(x<0) x+=1.;
+      int m0 = (int)(x*M_r);
+      double xi = 2.*M_PI*x - m0*delta;
+      double E1 = std::exp(-xi*xi/(4.*tau));
+      double E2 = std::exp(xi*delta/(2.*tau));
+      double E2_l = 1.;
+      for(int l=0;l<=M_sp;++l){ //points at and after m0
+        double g = E1*E2_l*E3[l];
+        int m = (m0+l)&(M_r-1);
+        G_grid[m] += g*meas;
+        F_grid[m] += g*fmeas;
+        E2_l *= E2;
+      }
+      E2_l = 1./E2;
+      for(int l=1;l<M_sp;++l){ //points before m0
+        double g = E1*E2_l*E3[l];
+        int m = (m0-l)&(M_r-1);
+        G_grid[m] += g*meas;
+        F_grid[m] += g*fmeas;
+        E2_l /= E2;
+      }
+    }
+  }
+  fft_positive(G_grid);
+  fft_positive(F_grid);
+
+  //deconvolve with the Fourier coefficients sqrt(tau/pi) exp(-k^2 tau) of the Gaussian
+  for(int wn=0; wn<N_w; wn++){
+    int k = wn-h;
+    double deconv = std::sqrt(M_PI/tau)*std::exp(k*k*tau)/M_r;
+    int m = k&(M_r-1);
+    Gwr[wn] += deconv*G_grid[m].real();
+    Gwi[wn] += deconv*G_grid[m].imag();
+    Fwr[wn] += deconv*F_grid[m].real();
+    Fwi[wn] += deconv*F_grid[m].imag();
+  }
+}
+
+//measures M(w1,w2)=sum_ij M_ji exp(i w1 tau_i) exp(-i w2 tau'_j). The sum factorizes into
+//T(w1,j)=sum_i M_ji exp(i w1 tau_i) and M(w1,w2)=sum_j T(w1,j) exp(-i w2 tau'_j), which costs
+//O(k^2 N_w_aux + k N_w_aux^2) instead of O(k^2 N_w_aux^2).
+void hybmatrix::measure_G2w(std::vector<std::complex<double> > &G2w, std::vector<std::complex<double> >&F2w, int N_w2, int N_w_aux, const prefactor_map_t &F_prefactor) const{
+  static std::vector<double> cdagger_times(size()); cdagger_times.resize(size());
+  static std::vector<double> c_times(size()); c_times.resize(size());
+  static std::vector<std::complex<double> > c_exp; c_exp.resize(size()*N_w_aux);             //c_exp[i*N_w_aux+w1n]=exp(i w1 tau_i)
+  static std::vector<std::complex<double> > cdagger_exp; cdagger_exp.resize(size()*N_w_aux); //cdagger_exp[j*N_w_aux+w2n]=exp(-i w2 tau'_j)
+  static std::vector<std::complex<double> > GT; GT.resize(N_w_aux*size());                  //GT[w1n*size()+j]=T(w1,j)
+  static std::vector<std::complex<double> > FT; FT.resize(N_w_aux*size());
 
   //create map of creator and annihilator times
   for (hyb_map_t::const_iterator it= c_index_map_.begin(); it != c_index_map_.end(); ++it) {
@@ -89,48 +205,48 @@ void hybmatrix::measure_G2w(std::vector<std::complex<double> > &G2w, std::vector
 
   memset(&(G2w[0]),0, G2w.size()*sizeof(std::complex<double>));
   memset(&(F2w[0]),0, F2w.size()*sizeof(std::complex<double>));
+  if(size()==0) return;
 
   double w_ini = (2*(-N_w2/2)+1)*M_PI/beta_;
   double w_inc = 2*M_PI/beta_;
-  for(int i=0;i<size();++i){ c_exp_ini      [i]=std::exp(std::complex<double>(0,  w_ini*c_times      [i])); }
-  for(int i=0;i<size();++i){ c_exp_inc      [i]=std::exp(std::complex<double>(0,  w_inc*c_times      [i])); }
-  for(int i=0;i<size();++i){ cdagger_exp_ini[i]=std::exp(std::complex<double>(0, -w_ini*cdagger_times[i])); }
-  for(int i=0;i<size();++i){ cdagger_exp_inc[i]=std::exp(std::complex<double>(0, -w_inc*cdagger_times[i])); }
+  for(int i=0;i<size();++i){
+    std::complex<double> exp1=std::exp(std::complex<double>(0,  w_ini*c_times[i]));
+    std::complex<double> exp1_inc=std::exp(std::complex<double>(0,  w_inc*c_times[i]));
+    std::complex<double> exp2=std::exp(std::complex<double>(0, -w_ini*cdagger_times[i]));
+    std::complex<double> exp2_inc=std::exp(std::complex<double>(0, -w_inc*cdagger_times[i]));
+    for(int wn=0; wn<N_w_aux; wn++){
+      c_exp[i*N_w_aux+wn]=exp1;
+      cdagger_exp[i*N_w_aux+wn]=exp2;
+      exp1*=exp1_inc;
+      exp2*=exp2_inc;
+    }
+  }
 
-  //measures the Fourier transform of G(tau,tau'):=-<T c(tau) c^dagger(tau')>
+  //first stage: transform the annihilator index
+  memset(&(GT[0]),0, GT.size()*sizeof(std::complex<double>));
+  if(measure_h2w_) memset(&(FT[0]),0, FT.size()*sizeof(std::complex<double>));
   double f_pref=0.0;
   for (int i = 0; i < size(); i++) {
     if(measure_h2w_) f_pref=(F_prefactor.find(c_times[i]))->second;
-    std::complex<double> exp1_ini=c_exp_ini[i];
-    std::complex<double> exp1_inc=c_exp_inc[i];
     for (int j = 0; j < size(); j++) {
-      std::complex<double> exp2_ini=cdagger_exp_ini[j];
-      std::complex<double> exp2_inc=cdagger_exp_inc[j];
-
-      std::complex<double> exp1=exp1_ini;
-      std::complex<double> exp2=exp2_ini;
-
       std::complex<double> M_ji = operator() (j, i);
-
       for(int w1n=0; w1n<N_w_aux; w1n++){
-        for(int w2n=0; w2n<N_w_aux; w2n++){
-          if(measure_g2w_ || measure_h2w_){
-            std::complex<double> meas = M_ji*exp1*exp2;
-            G2w[w1n*N_w_aux+w2n] += meas;
-          }
-          if(measure_h2w_){
-            std::complex<double> fmeas = f_pref*M_ji*exp1*exp2;
-            F2w[w1n*N_w_aux+w2n] += fmeas;
-          }
-          exp2*=exp2_inc;//update exp2
-        }
-        exp2=exp2_ini;//reset exp2
-        exp1*=exp1_inc;//update exp1
+        std::complex<double> meas = M_ji*c_exp[i*N_w_aux+w1n];
+        GT[w1n*size()+j] += meas;
+        if(measure_h2w_) FT[w1n*size()+j] += f_pref*meas;
       }
+    }
+  }
 
+  //second stage: transform the creator index
+  for(int w1n=0; w1n<N_w_aux; w1n++){
+    for (int j = 0; j < size(); j++) {
+      std::complex<double> gt=GT[w1n*size()+j];
+      std::complex<double> ft=FT[w1n*size()+j];
+      for(int w2n=0; w2n<N_w_aux; w2n++){
+        if(measure_g2w_ || measure_h2w_) G2w[w1n*N_w_aux+w2n] += gt*cdagger_exp[j*N_w_aux+w2n];
+        if(measure_h2w_) F2w[w1n*N_w_aux+w2n] += ft*cdagger_exp[j*N_w_aux+w2n];
+      }
     }
   }
 }
-
-
-
@@ -258,7 +258,7 @@ void hybridization::accumulate_order(){
 }
 
 //measure the Green's function
-void hybridization::measure_G(std::vector<std::map<double,double> > &F_prefactor){
+void hybridization::measure_G(std::vector<prefactor_map_t > &F_prefactor){
   if(!MEASURE_time) return;
   //delegate the actual measurement to the hybridization configuration
   hyb_config.measure_G(G, F, F_prefactor, sign);
@@ -347,7 +347,7 @@ void hybridization::accumulate_nnw(){
   }
 }
 
-void hybridization::measure_Gw(std::vector<std::map<double,double> > &F_prefactor){
+void hybridization::measure_Gw(std::vector<prefactor_map_t > &F_prefactor){
   if(!MEASURE_freq) return;
 
   //compute frequency quantities
@@ -368,7 +368,7 @@ void hybridization::accumulate_Gw(){
     }
 }
 
-void hybridization::measure_Gl(std::vector<std::map<double,double> > &F_prefactor){
+void hybridization::measure_Gl(std::vector<prefactor_map_t > &F_prefactor){
   if(!MEASURE_legendre) return;
   //compute legendre quantities
   hyb_config.measure_Gl(Gl, Fl, F_prefactor, sign);
@@ -384,7 +384,7 @@ void hybridization::accumulate_Gl(){
     }
 }
 
-void hybridization::measure_G2w(std::vector<std::map<double,double> > &F_prefactor){
+void hybridization::measure_G2w(std::vector<prefactor_map_t > &F_prefactor){
 
   //compute two-frequency quantities
   hyb_config.measure_G2w(G2w, F2w, N_w2, N_w_aux, F_prefactor);
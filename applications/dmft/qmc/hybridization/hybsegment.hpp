@@ -28,6 +28,7 @@
 #ifndef HYB_SEG_HPP
 #define HYB_SEG_HPP
 #include<fstream>
+#include<boost/container/flat_map.hpp>
 
 //the struct 'segment' has a start and an end time and a comparison function.
 //segment describes a pair of operators in an orbital: t_start is the c^\dagger, t_end is the c operator.
@@ -43,4 +44,7 @@ struct segment
 
 std::ostream &operator<<(std::ostream &os, const segment &s);
 
+//F_prefactor of the annihilators of one orbital, keyed by their time
+typedef boost::container::flat_map<double,double> prefactor_map_t;
+
 #endif
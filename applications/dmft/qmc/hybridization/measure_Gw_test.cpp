@@ -0,0 +1,116 @@
+/****************************************************************************
+ *
+ * ALPS DMFT Project
+ *
+ * Copyright (C) 2012 by Emanuel Gull <gull@pks.mpg.de>,
+ *                       Hartmut Hafermann <hafermann@cpht.polytechnique.fr>
+ *
+ *  based on an earlier version by Philipp Werner and Emanuel Gull
+ *
+ *
+ * This software is part of the ALPS Applications, published under the ALPS
+ * Application License; you can use, redistribute it and/or modify it under
+ * the terms of the license, either version 1 or (at your option) any later
+ * version.
+ *
+ * You should have received a copy of the ALPS Application License along with
+ * the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+ * available from http://alps.comp-phys.org/.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+//checks that G(iw_n) and F(iw_n) measured with MEASURE_freq_nfft agree with the direct sum over
+//all pairs of times and frequencies, on a fixed configuration of one orbital that includes a
+//segment winding around beta. The difference relative to the largest |G(iw_n)| has to be below 1e-10.
+
+#include "hybmatrix.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+int global_mpi_rank=1; //keeps hybfun from printing the hybridization function
+
+//hybridization function of a bath of equally spaced levels in [-2,2], written as DELTA file
+void write_delta(const std::string &fname, double beta, int n_tau){
+  const int n_levels=50;
+  std::ofstream out(fname.c_str());
+  out.precision(17);
+  for(int i=0;i<=n_tau;++i){
+    double tau=beta*i/n_tau;
+    double delta=0.;
+    for(int l=0;l<n_levels;++l){
+      double eps=-2.+4.*(l+0.5)/n_levels;
+      delta-=std::exp(-tau*eps)/(1.+std::exp(-beta*eps))/n_levels;
+    }
+    out<<i<<" "<<delta<<std::endl;
+  }
+}
+
+//fills G(iw_n) and F(iw_n) for the fixed configuration, with or without the nfft
+void measure(const alps::params &p_in, bool nfft, std::vector<double> &Gwr, std::vector<double> &Gwi, std::vector<double> &Fwr, std::vector<double> &Fwi){
+  alps::params p(p_in);
+  p["MEASURE_freq_nfft"]=nfft ? 1 : 0;
+  hybfun Delta(p);
+  hybmatrix M(p);
+  const double times[][2]={{0.3,1.1},{1.7,2.05},{2.9,4.4},{5.0,5.3},{6.1,7.8},{8.2,8.9},{9.4,0.1}};
+  prefactor_map_t F_prefactor;
+  for(std::size_t i=0;i<sizeof(times)/sizeof(times[0]);++i){
+    segment s(times[i][0], times[i][1]);
+    M.hyb_weight_change_insert(s, 0, Delta);
+    M.insert_segment(s, 0);
+    F_prefactor[s.t_end_]=0.5+0.1*i;
+  }
+  std::fill(Gwr.begin(), Gwr.end(), 0.);
+  std::fill(Gwi.begin(), Gwi.end(), 0.);
+  std::fill(Fwr.begin(), Fwr.end(), 0.);
+  std::fill(Fwi.begin(), Fwi.end(), 0.);
+  M.measure_Gw(Gwr, Gwi, Fwr, Fwi, F_prefactor, 1.);
+}
+
+//largest |a-b| relative to the largest |a|
+double relative_difference(const std::vector<double> &ar, const std::vector<double> &ai, const std::vector<double> &br, const std::vector<double> &bi){
+  double diff=0., norm=0.;
+  for(std::size_t n=0;n<ar.size();++n){
+    diff=std::max(diff, std::abs(std::complex<double>(ar[n]-br[n], ai[n]-bi[n])));
+    norm=std::max(norm, std::abs(std::complex<double>(ar[n], ai[n])));
+  }
+  return diff/norm;
+}
+
+int main(){
+  const double beta=10.;
+  const int n_tau=1000;
+  const int n_w=250;
+  const double tolerance=1.e-10;
+  write_delta("measure_Gw_test_delta.dat", beta, n_tau);
+
+  alps::params p;
+  p["BETA"]=beta;
+  p["N_TAU"]=n_tau;
+  p["N_ORBITALS"]=1;
+  p["DELTA"]="measure_Gw_test_delta.dat";
+
+  std::vector<double> Gwr(n_w), Gwi(n_w), Fwr(n_w), Fwi(n_w);
+  std::vector<double> Gwr_nfft(n_w), Gwi_nfft(n_w), Fwr_nfft(n_w), Fwi_nfft(n_w);
+  measure(p, false, Gwr, Gwi, Fwr, Fwi);
+  measure(p, true, Gwr_nfft, Gwi_nfft, Fwr_nfft, Fwi_nfft);
+
+  double G_diff=relative_difference(Gwr, Gwi, Gwr_nfft, Gwi_nfft);
+  double F_diff=relative_difference(Fwr, Fwi, Fwr_nfft, Fwi_nfft);
+  std::cout<<"G(iw_n), "<<n_w<<" frequencies: "<<(G_diff<tolerance ? "ok" : "failed")<<std::endl;
+  std::cout<<"F(iw_n), "<<n_w<<" frequencies: "<<(F_diff<tolerance ? "ok" : "failed")<<std::endl;
+  if(G_diff>=tolerance || F_diff>=tolerance){
+    std::cerr<<"relative differences "<<G_diff<<" and "<<F_diff<<" exceed "<<tolerance<<std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*****************************************************************************
+ *
+ * ALPS MPS DMRG Project
+ *
+ * Copyright (C) 2015 Institute for Theoretical Physics, ETH Zurich
+ *               2015-2015 by Michele Dolfi <dolfim@phys.ethz.ch>
+ *
+ * This software is part of the ALPS Applications, published under the ALPS
+ * Application License; you can use, redistribute it and/or modify it under
+ * the terms of the license, either version 1 or (at your option) any later
+ * version.
+ *
+ * You should have received a copy of the ALPS Application License along with
+ * the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+ * available from http://alps.comp-phys.org/.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+
+// BLOCK GEMM BENCHMARK
+// -------------------
+// This program times the boundary products t[b] = transpose(left[b]) * mps
+// and t[b] = mps * right[b] for all MPO bonds b, with symmetry sectors of
+// very different sizes. It compares running all block products as parallel
+// tasks with running those of at least the given number of multiply-adds one
+// after the other on a threaded BLAS, and checks that both give the same
+// result. The number of threads is taken from OMP_NUM_THREADS, the threads
+// of the BLAS from its own settings (e.g. OPENBLAS_NUM_THREADS).
+//
+// usage: mps_block_gemm_benchmark [sectors] [largest sector] [MPO bond dimension] [repetitions] [threshold]
+
+
+#include <iostream>
+#include <limits>
+
+#include "dmrg/block_matrix/detail/alps.hpp"
+typedef alps::numeric::matrix<double> matrix;
+
+#include "dmrg/block_matrix/symmetry.h"
+#include "dmrg/mp_tensors/contraction_schedule.h"
+
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/random.hpp>
+
+typedef U1 grp;
+
+template<class Matrix>
+void fill(block_matrix<Matrix, grp> & m, boost::mt19937 & eng)
+{
+    boost::uniform_real<> dist(-1., 1.);
+    for (std::size_t k = 0; k < m.n_blocks(); ++k)
+        for (std::size_t j = 0; j < num_cols(m[k]); ++j)
+            for (std::size_t i = 0; i < num_rows(m[k]); ++i)
+                m[k](i, j) = dist(eng);
+}
+
+double run(Boundary<matrix, grp> const & left, Boundary<matrix, grp> const & right,
+           block_matrix<matrix, grp> const & mps, int repetitions,
+           std::vector<block_matrix<matrix, grp> > & tl, std::vector<block_matrix<matrix, grp> > & tr)
+{
+    boost::chrono::high_resolution_clock::time_point start = boost::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        contraction_schedule::left_mult_mps(left, mps, tl);
+        contraction_schedule::right_mult_mps(mps, right, tr);
+    }
+    return boost::chrono::duration<double>(boost::chrono::high_resolution_clock::now() - start).count();
+}
+
+double max_difference(std::vector<block_matrix<matrix, grp> > const & t0, std::vector<block_matrix<matrix, grp> > const & t1)
+{
+    double ret = 0.;
+    for (std::size_t b = 0; b < t0.size(); ++b)
+        for (std::size_t k = 0; k < t0[b].n_blocks(); ++k)
+            for (std::size_t j = 0; j < num_cols(t0[b][k]); ++j)
+                for (std::size_t i = 0; i < num_rows(t0[b][k]); ++i)
+                    ret = std::max(ret, std::abs(t0[b][k](i, j) - t1[b][k](i, j)));
+    return ret;
+}
+
+int main(int argc, char ** argv)
+{
+    try {
+        int sectors = argc > 1 ? boost::lexical_cast<int>(argv[1]) : 40;
+        int max_dim = argc > 2 ? boost::lexical_cast<int>(argv[2]) : 64;
+        int aux_dim = argc > 3 ? boost::lexical_cast<int>(argv[3]) : 16;
+        int repetitions = argc > 4 ? boost::lexical_cast<int>(argv[4]) : 10;
+        double threshold = argc > 5 ? boost::lexical_cast<double>(argv[5]) : 64.*64.*64.;
+        
+        // sector dimensions between 1 and max_dim, the boundaries have 4 times as many
+        Index<grp> rows, cols;
+        for (int q = 0; q < sectors; ++q) {
+            std::size_t d = 1 + q % max_dim;
+            rows.insert(std::make_pair(q, d));
+            cols.insert(std::make_pair(q, 4 * d));
+        }
+        
+        boost::mt19937 eng(42);
+        Boundary<matrix, grp> left(rows, rows, aux_dim), right(cols, cols, aux_dim);
+        for (int b = 0; b < aux_dim; ++b) {
+            fill(left[b], eng);
+            fill(right[b], eng);
+        }
+        block_matrix<matrix, grp> mps(rows, cols);
+        fill(mps, eng);
+        
+        std::cout << "sectors: " << sectors << ", largest sector: " << max_dim
+                  << ", MPO bond dimension: " << aux_dim << ", threshold: " << threshold << std::endl;
+        std::vector<block_matrix<matrix, grp> > tl0(aux_dim), tr0(aux_dim), tl1(aux_dim), tr1(aux_dim);
+        
+        std::cout << "tasks [s]\tsplit [s]\tspeedup" << std::endl;
+        batched_gemm_threshold() = std::numeric_limits<double>::infinity();
+        double time0 = run(left, right, mps, repetitions, tl0, tr0);
+        batched_gemm_threshold() = threshold;
+        double time1 = run(left, right, mps, repetitions, tl1, tr1);
+        double diff = std::max(max_difference(tl0, tl1), max_difference(tr0, tr1));
+        std::cout << time0 << "\t" << time1 << "\t" << time0 / time1 << std::endl;
+        std::cout << "max difference: " << diff << std::endl;
+        
+    } catch (std::exception & e) {
+        std::cerr << "Exception thrown:" << std::endl;
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ *
+ * ALPS MPS DMRG Project
+ *
+ * Copyright (C) 2015 Institute for Theoretical Physics, ETH Zurich
+ *               2015-2015 by Michele Dolfi <dolfim@phys.ethz.ch>
+ *
+ * This software is part of the ALPS Applications, published under the ALPS
+ * Application License; you can use, redistribute it and/or modify it under
+ * the terms of the license, either version 1 or (at your option) any later
+ * version.
+ *
+ * You should have received a copy of the ALPS Application License along with
+ * the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+ * available from http://alps.comp-phys.org/.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+// TWO-SITE SWEEP BENCHMARK
+// ------------------------
+// This program times a full two-site DMRG sweep of the Hubbard model on a
+// ladder for an increasing number of OpenMP threads. All runs start from
+// the same random MPS and therefore do the same work. The sectors of the
+// N and Sz quantum numbers have very different sizes, which makes the
+// boundary contractions unevenly sized tasks.
+// The lattice, model and symmetry are specified in the code below.
+//
+// usage: mps_ts_sweep_benchmark [length] [bond dimension] [max threads]
+
+
+#include <alps/utility/copyright.hpp>
+#include <iostream>
+
+#include "dmrg/version.h"
+
+#include "dmrg/block_matrix/detail/alps.hpp"
+typedef alps::numeric::matrix<double> matrix;
+
+#include "dmrg/mp_tensors/mps.h"
+#include "dmrg/mp_tensors/mpo.h"
+
+#include "dmrg/models/model.h"
+#include "dmrg/models/lattice.h"
+#include "dmrg/models/generate_mpo.hpp"
+
+#include "dmrg/optimize/optimize.h"
+#include "dmrg/utils/DmrgParameters.h"
+
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+
+#ifdef MAQUIS_OPENMP
+#include <omp.h>
+#endif
+
+
+/// build with NU1 symmetry
+typedef NU1 grp;
+
+int main(int argc, char ** argv)
+{
+    try {
+        int L = argc > 1 ? boost::lexical_cast<int>(argv[1]) : 16;
+        int M = argc > 2 ? boost::lexical_cast<int>(argv[2]) : 512;
+        int max_threads = argc > 3 ? boost::lexical_cast<int>(argv[3]) : 64;
+        
+        DmrgParameters parms;
+        parms.set("LATTICE", "open ladder");
+        parms.set("L",       L            );
+        parms.set("MODEL",   "fermion Hubbard");
+        parms.set("CONSERVED_QUANTUMNUMBERS", "Nup,Ndown");
+        parms.set("Nup_total",   L);
+        parms.set("Ndown_total", L);
+        parms.set("t",  1.);
+        parms.set("t'", 1.);
+        parms.set("U",  8.);
+        parms.set("max_bond_dimension",  M);
+        parms.set("init_bond_dimension", M);
+        parms.set("nsweeps", 1);
+        parms.set("ietl_jcd_maxiter", 4);
+        
+        Lattice lattice(parms);
+        Model<matrix, grp> model(lattice, parms);
+        MPO<matrix, grp> mpo = make_mpo(lattice, model, parms);
+        MPS<matrix, grp> initial_mps(lattice.size(), *(model.initializer(lattice, parms)));
+        
+        std::cout << "sites: " << lattice.size() << ", bond dimension: " << M << std::endl;
+        std::cout << "threads\tsweep [s]\tspeedup" << std::endl;
+        double t1 = 0.;
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+#ifdef MAQUIS_OPENMP
+            omp_set_num_threads(threads);
+#else
+            if (threads > 1) break;
+#endif
+            MPS<matrix, grp> mps = initial_mps;
+            ts_optimize<matrix, grp, storage::nop> optimizer(mps, mpo, parms, boost::ptr_vector<dmrg::stop_callback_base>());
+            
+            boost::chrono::high_resolution_clock::time_point start = boost::chrono::high_resolution_clock::now();
+            optimizer.sweep(0, Both);
+            double elapsed = boost::chrono::duration<double>(boost::chrono::high_resolution_clock::now() - start).count();
+            if (threads == 1)
+                t1 = elapsed;
+            std::cout << threads << "\t" << elapsed << "\t" << t1 / elapsed << std::endl;
+        }
+        
+    } catch (std::exception & e) {
+        std::cerr << "Exception thrown:" << std::endl;
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+}
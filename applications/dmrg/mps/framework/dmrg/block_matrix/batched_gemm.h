@@ -0,0 +1,91 @@
+/*****************************************************************************
+ *
+ * ALPS MPS DMRG Project
+ *
+ * Copyright (C) 2013 Institute for Theoretical Physics, ETH Zurich
+ *               2011-2013 by Michele Dolfi <dolfim@phys.ethz.ch>
+ * 
+ * This software is part of the ALPS Applications, published under the ALPS
+ * Application License; you can use, redistribute it and/or modify it under
+ * the terms of the license, either version 1 or (at your option) any later
+ * version.
+ * 
+ * You should have received a copy of the ALPS Application License along with
+ * the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+ * available from http://alps.comp-phys.org/.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT 
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE 
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef BATCHED_GEMM_H
+#define BATCHED_GEMM_H
+
+#include <cstddef>
+#include <vector>
+
+// A block_matrix product consists of one GEMM per symmetry block, and the
+// boundary contractions consist of many block_matrix products. The block
+// sizes differ by orders of magnitude. batched_gemm collects the block
+// products, so that they can be executed in two passes: products with at
+// least batched_gemm_threshold() multiply-adds one after the other, outside
+// any parallel region, so that a threaded BLAS uses all cores on each of
+// them, and the remaining small ones as independent tasks.
+
+inline double & batched_gemm_threshold()
+{
+    static double threshold = 64.*64.*64.;
+    return threshold;
+}
+
+template<class Matrix1, class Matrix2, class Matrix3>
+class batched_gemm
+{
+public:
+    // c = a * b, where c has the right size; the matrices have to stay in
+    // place until the product is executed
+    void push_back(Matrix1 const & a, Matrix2 const & b, Matrix3 & c)
+    {
+        product p = { &a, &b, &c };
+        products.push_back(p);
+        costs_.push_back(double(num_rows(a)) * num_cols(a) * num_cols(b));
+    }
+    
+    std::size_t size() const { return products.size(); }
+    
+    // multiply-adds of the products
+    std::vector<double> const & costs() const { return costs_; }
+    
+    bool is_large(std::size_t i) const { return costs_[i] >= batched_gemm_threshold(); }
+    
+    // executes the i-th product; different products may run concurrently
+    void execute(std::size_t i) const
+    {
+        product const & p = products[i];
+        gemm(*p.a, *p.b, *p.c);
+    }
+    
+    void clear()
+    {
+        products.clear();
+        costs_.clear();
+    }
+    
+private:
+    struct product {
+        Matrix1 const * a;
+        Matrix2 const * b;
+        Matrix3 * c;
+    };
+    
+    std::vector<product> products;
+    std::vector<double> costs_;
+};
+
+#endif
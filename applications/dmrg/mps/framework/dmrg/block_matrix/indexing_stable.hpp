@@ -270,12 +270,12 @@ private:
         data_.push_back(x);
     }
     
+    // the data is sorted by decreasing charge, so the first element with
+    // a smaller charge is found by bisection
     std::size_t destination(charge c) const
     {
-        return std::find_if(data_.begin(), data_.end(),
-                            boost::lambda::bind(index_detail::lt<SymmGroup>,
-                                                boost::lambda::_1,
-                                                std::make_pair(c, 0))) - data_.begin();
+        return std::upper_bound(data_.begin(), data_.end(), std::make_pair(c, 0),
+                                index_detail::gt<SymmGroup>()) - data_.begin();
     }
 
 public:
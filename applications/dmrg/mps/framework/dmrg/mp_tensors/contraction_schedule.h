@@ -0,0 +1,205 @@
+/*****************************************************************************
+ *
+ * ALPS MPS DMRG Project
+ *
+ * Copyright (C) 2013 Institute for Theoretical Physics, ETH Zurich
+ *               2011-2013 by Michele Dolfi <dolfim@phys.ethz.ch>
+ * 
+ * This software is part of the ALPS Applications, published under the ALPS
+ * Application License; you can use, redistribute it and/or modify it under
+ * the terms of the license, either version 1 or (at your option) any later
+ * version.
+ * 
+ * You should have received a copy of the ALPS Application License along with
+ * the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+ * available from http://alps.comp-phys.org/.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT 
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE 
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+ * DEALINGS IN THE SOFTWARE.
+ *
+ *****************************************************************************/
+
+#ifndef CONTRACTION_SCHEDULE_H
+#define CONTRACTION_SCHEDULE_H
+
+#include "dmrg/mp_tensors/mpotensor.h"
+#include "dmrg/mp_tensors/boundary.h"
+#include "dmrg/block_matrix/block_matrix.h"
+#include "dmrg/block_matrix/block_matrix_algorithms.h"
+#include "dmrg/block_matrix/batched_gemm.h"
+#include "dmrg/utils/parallel_for.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// The boundary contractions consist of many independent products whose
+// sizes differ by orders of magnitude between MPO bonds and symmetry
+// blocks. The functions below hand them to parallel_for as tasks, largest
+// first, so that the dynamic schedule does not end with one thread working
+// on a large block while the others are idle.
+
+namespace contraction_schedule {
+
+    namespace detail {
+        struct larger_cost {
+            larger_cost(std::vector<double> const & costs_) : costs(costs_) { }
+            bool operator()(std::size_t i, std::size_t j) const { return costs[i] > costs[j]; }
+            std::vector<double> const & costs;
+        };
+        
+        template<class Matrix, class SymmGroup>
+        double num_elements(block_matrix<Matrix, SymmGroup> const & m)
+        {
+            double ret = 0;
+            for (std::size_t k = 0; k < m.n_blocks(); ++k)
+                ret += double(num_rows(m[k])) * num_cols(m[k]);
+            return ret;
+        }
+    }
+    
+    // Returns the task indices ordered by decreasing cost. Without OpenMP the
+    // tasks keep their order, so that serial results do not change.
+    inline std::vector<std::size_t> largest_first(std::vector<double> const & costs)
+    {
+        std::vector<std::size_t> order(costs.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+#ifdef MAQUIS_OPENMP
+        std::stable_sort(order.begin(), order.end(), detail::larger_cost(costs));
+#endif
+        return order;
+    }
+    
+    // Collects the block GEMMs of several block_matrix products with
+    // batched_gemm. The large ones are executed one after the other with a
+    // threaded BLAS, the others as tasks, largest first.
+    template<class Matrix1, class Matrix2, class Matrix3, class SymmGroup>
+    class gemm_tasks
+    {
+    public:
+        // same as gemm_trim_left(A, B, C), but C is only allocated until execute()
+        void add_trim_left(block_matrix<Matrix1, SymmGroup> const & A,
+                           block_matrix<Matrix2, SymmGroup> const & B,
+                           block_matrix<Matrix3, SymmGroup> & C)
+        {
+            C.clear();
+            for (std::size_t k = 0; k < A.n_blocks(); ++k) {
+                std::size_t matched_block = B.left_basis().position(A.right_basis()[k].first);
+                if ( matched_block == B.left_basis().size() )
+                    continue;
+                if ( !B.left_basis().has(A.left_basis()[k].first) )
+                    continue;
+                
+                std::size_t new_block = C.insert_block(new Matrix3(num_rows(A[k]), num_cols(B[matched_block])),
+                                                       A.left_basis()[k].first, B.right_basis()[matched_block].first);
+                products.push_back(A[k], B[matched_block], C[new_block]);
+            }
+        }
+        
+        // same as gemm_trim_right(A, B, C), but C is only allocated until execute()
+        void add_trim_right(block_matrix<Matrix1, SymmGroup> const & A,
+                            block_matrix<Matrix2, SymmGroup> const & B,
+                            block_matrix<Matrix3, SymmGroup> & C)
+        {
+            C.clear();
+            for (std::size_t k = 0; k < B.n_blocks(); ++k) {
+                std::size_t matched_block = A.right_basis().position(B.left_basis()[k].first);
+                if ( matched_block == A.right_basis().size() )
+                    continue;
+                if ( !A.right_basis().has(B.right_basis()[k].first) )
+                    continue;
+                
+                std::size_t new_block = C.insert_block(new Matrix3(num_rows(A[matched_block]), num_cols(B[k])),
+                                                       A.left_basis()[matched_block].first, B.right_basis()[k].first);
+                products.push_back(A[matched_block], B[k], C[new_block]);
+            }
+        }
+        
+        // The blocks are owned by ptr_vectors and do not move when further
+        // blocks are inserted, so the pointers stay valid until here.
+        void execute()
+        {
+            std::vector<std::size_t> order = largest_first(products.costs());
+            std::size_t first_small = 0;
+            for (; first_small < order.size() && products.is_large(order[first_small]); ++first_small)
+                products.execute(order[first_small]);
+            std::size_t loop_max = order.size();
+            parallel_for(/*removed...*/, std::size_t i = first_small; i < loop_max; ++i)
+                products.execute(order[i]);
+            products.clear();
+        }
+        
+    private:
+        batched_gemm<Matrix1, Matrix2, Matrix3> products;
+    };
+    
+    // t[b] = transpose(left[b]) * mps for all MPO bonds b
+    template<class Matrix, class OtherMatrix, class SymmGroup>
+    void left_mult_mps(Boundary<OtherMatrix, SymmGroup> const & left,
+                       block_matrix<Matrix, SymmGroup> const & mps,
+                       std::vector<block_matrix<Matrix, SymmGroup> > & t)
+    {
+        typedef typename maquis::traits::transpose_view<OtherMatrix>::type transposed;
+        std::vector<block_matrix<transposed, SymmGroup> > left_t(left.aux_dim());
+        gemm_tasks<transposed, Matrix, Matrix, SymmGroup> tasks;
+        for (std::size_t b = 0; b < left.aux_dim(); ++b) {
+            left_t[b] = transpose(left[b]);
+            tasks.add_trim_left(left_t[b], mps, t[b]);
+        }
+        tasks.execute();
+    }
+    
+    // t[b] = mps * right[b] for all MPO bonds b
+    template<class Matrix, class OtherMatrix, class SymmGroup>
+    void right_mult_mps(block_matrix<Matrix, SymmGroup> const & mps,
+                        Boundary<OtherMatrix, SymmGroup> const & right,
+                        std::vector<block_matrix<Matrix, SymmGroup> > & t)
+    {
+        gemm_tasks<Matrix, OtherMatrix, Matrix, SymmGroup> tasks;
+        for (std::size_t b = 0; b < right.aux_dim(); ++b)
+            tasks.add_trim_right(mps, right[b], t[b]);
+        tasks.execute();
+    }
+    
+    // order of the columns b2 of the MPO tensor for lbtm_kernel, whose
+    // cost is estimated by the size of the left_mult_mps it reads
+    template<class Matrix, class SymmGroup>
+    std::vector<std::size_t> lbtm_order(MPOTensor<Matrix, SymmGroup> const & mpo,
+                                        std::vector<block_matrix<Matrix, SymmGroup> > const & left_mult_mps)
+    {
+        typedef typename MPOTensor<Matrix, SymmGroup>::col_proxy col_proxy;
+        std::vector<double> costs(mpo.col_dim(), 0.);
+#ifdef MAQUIS_OPENMP
+        for (std::size_t b2 = 0; b2 < mpo.col_dim(); ++b2) {
+            col_proxy col_b2 = mpo.column(b2);
+            for (typename col_proxy::const_iterator col_it = col_b2.begin(); col_it != col_b2.end(); ++col_it)
+                costs[b2] += detail::num_elements(left_mult_mps[col_it.index()]);
+        }
+#endif
+        return largest_first(costs);
+    }
+    
+    // order of the rows b1 of the MPO tensor for rbtm_kernel
+    template<class Matrix, class SymmGroup>
+    std::vector<std::size_t> rbtm_order(MPOTensor<Matrix, SymmGroup> const & mpo,
+                                        std::vector<block_matrix<Matrix, SymmGroup> > const & right_mult_mps)
+    {
+        typedef typename MPOTensor<Matrix, SymmGroup>::row_proxy row_proxy;
+        std::vector<double> costs(mpo.row_dim(), 0.);
+#ifdef MAQUIS_OPENMP
+        for (std::size_t b1 = 0; b1 < mpo.row_dim(); ++b1) {
+            row_proxy row_b1 = mpo.row(b1);
+            for (typename row_proxy::const_iterator row_it = row_b1.begin(); row_it != row_b1.end(); ++row_it)
+                costs[b1] += detail::num_elements(right_mult_mps[row_it.index()]);
+        }
+#endif
+        return largest_first(costs);
+    }
+}
+
+#endif
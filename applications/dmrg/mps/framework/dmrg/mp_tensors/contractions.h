@@ -29,6 +29,7 @@
 
 #include "dmrg/mp_tensors/mpstensor.h"
 #include "dmrg/mp_tensors/mpotensor.h"
+#include "dmrg/mp_tensors/contraction_schedule.h"
 
 #include "dmrg/mp_tensors/reshapes.h"
 #include "dmrg/block_matrix/indexing.h"
@@ -263,18 +264,13 @@ struct contraction {
                              Index<SymmGroup> const * in_low = NULL)
     {
         typedef typename SymmGroup::charge charge;
-        typedef std::size_t size_t;
 
         if (in_low == NULL)
             in_low = &mps.row_dim();
         
         mps.make_right_paired();
         std::vector<block_matrix<Matrix, SymmGroup> > t(left.aux_dim());
-        size_t loop_max = left.aux_dim();
-
-        parallel_for(/*removed...*/, std::size_t b = 0; b < loop_max; ++b){
-            gemm_trim_left(transpose(left[b]), mps.data(), t[b]);
-        }
+        contraction_schedule::left_mult_mps(left, mps.data(), t);
 
         Index<SymmGroup> physical_i = mps.site_dim(), left_i = *in_low, right_i = mps.col_dim(),
                                       out_left_i = physical_i * left_i;
@@ -286,9 +282,11 @@ struct contraction {
         Boundary<Matrix, SymmGroup> ret;
         ret.resize(mpo.col_dim());
 
-        loop_max = mpo.col_dim();
+        std::size_t loop_max = mpo.col_dim();
+        std::vector<std::size_t> order = contraction_schedule::lbtm_order(mpo, t);
 
-        parallel_for(l/*removed...*/, std::size_t b2 = 0; b2 < loop_max; ++b2) {
+        parallel_for(l/*removed...*/, std::size_t i = 0; i < loop_max; ++i) {
+            std::size_t b2 = order[i];
             ret[b2] = lbtm_kernel(b2, left, t, mpo, physical_i, right_i, out_left_i, in_right_pb, out_left_pb);
         }
 
@@ -303,18 +301,13 @@ struct contraction {
                               Index<SymmGroup> const * in_low = NULL)
     {
         typedef typename SymmGroup::charge charge;
-        typedef std::size_t size_t;
 
         if (in_low == NULL)
             in_low = &mps.col_dim();
         
         mps.make_left_paired();
         std::vector<block_matrix<Matrix, SymmGroup> > t(right.aux_dim());
-        size_t loop_max = right.aux_dim();
-
-        parallel_for(/*removed...*/, std::size_t b = 0; b < loop_max; ++b){
-            gemm_trim_right(mps.data(), right[b], t[b]);
-        }
+        contraction_schedule::right_mult_mps(mps.data(), right, t);
         
         Index<SymmGroup> physical_i = mps.site_dim(), left_i = mps.row_dim(), right_i = *in_low,
                          out_right_i = adjoin(physical_i) * right_i;
@@ -326,9 +319,11 @@ struct contraction {
         Boundary<Matrix, SymmGroup> ret;
         ret.resize(mpo.row_dim());
         
-        loop_max = mpo.row_dim();
+        std::size_t loop_max = mpo.row_dim();
+        std::vector<std::size_t> order = contraction_schedule::rbtm_order(mpo, t);
 
-        parallel_for(l/*removed...*/, std::size_t b1 = 0; b1 < loop_max; ++b1) {
+        parallel_for(l/*removed...*/, std::size_t i = 0; i < loop_max; ++i) {
+            std::size_t b1 = order[i];
             ret[b1] = rbtm_kernel(b1, right, t, mpo, physical_i, left_i, right_i, out_right_i, in_left_pb, out_right_pb);
         }
 
@@ -349,11 +344,7 @@ struct contraction {
             // Make a copy of ket_tensor to avoid reshaping back to left
             MPSTensor<Matrix, SymmGroup> ket_cpy = ket_tensor;
             ket_cpy.make_right_paired();
-            std::size_t loop_max = left.aux_dim();
-
-            parallel_for(/*locale::scatter(mpo.placement_l)*/, std::size_t b = 0; b < loop_max; ++b) {
-                gemm_trim_left(transpose(left[b]), ket_cpy.data(), t[b]);
-            }
+            contraction_schedule::left_mult_mps(left, ket_cpy.data(), t);
         }
 
         Index<SymmGroup> const & left_i = bra_tensor.row_dim();
@@ -369,10 +360,12 @@ struct contraction {
 
         //ket_tensor.make_left_paired();
         std::size_t loop_max = mpo.col_dim();
+        std::vector<std::size_t> order = contraction_schedule::lbtm_order(mpo, t);
 
         bra_tensor.make_left_paired();
         block_matrix<Matrix, SymmGroup> bra_conj = conjugate(bra_tensor.data());
-        parallel_for(/*locale::scatter(mpo.placement_r)*/, std::size_t b2 = 0; b2 < loop_max; ++b2) {
+        parallel_for(/*locale::scatter(mpo.placement_r)*/, std::size_t i = 0; i < loop_max; ++i) {
+            std::size_t b2 = order[i];
             block_matrix<Matrix, SymmGroup> tmp;
             tmp = lbtm_kernel(b2, left, t, mpo, ket_tensor.site_dim(), right_i, out_left_i, in_right_pb, out_left_pb);
             gemm(transpose(tmp), bra_conj, ret[b2]);
@@ -395,11 +388,7 @@ struct contraction {
             // Make a copy of ket_tensor to avoid reshaping back to right
             MPSTensor<Matrix, SymmGroup> ket_cpy = ket_tensor;
             ket_cpy.make_left_paired();
-            std::size_t loop_max = right.aux_dim();
-
-            parallel_for(/*locale::scatter(mpo.placement_r)*/, std::size_t b = 0; b < loop_max; ++b){
-                gemm_trim_right(ket_cpy.data(), right[b], t[b]);
-            }
+            contraction_schedule::right_mult_mps(ket_cpy.data(), right, t);
         }
 
         Index<SymmGroup> const & left_i = ket_tensor.row_dim();
@@ -414,10 +403,12 @@ struct contraction {
 
         //ket_tensor.make_right_paired();
         std::size_t loop_max = mpo.row_dim();
+        std::vector<std::size_t> order = contraction_schedule::rbtm_order(mpo, t);
 
         bra_tensor.make_right_paired();
         block_matrix<Matrix, SymmGroup> bra_conj = conjugate(bra_tensor.data());
-        parallel_for(/*locale::scatter(mpo.placement_l)*/, std::size_t b1 = 0; b1 < loop_max; ++b1) {
+        parallel_for(/*locale::scatter(mpo.placement_l)*/, std::size_t i = 0; i < loop_max; ++i) {
+            std::size_t b1 = order[i];
             block_matrix<Matrix, SymmGroup> tmp;
             tmp = rbtm_kernel(b1, right, t, mpo, ket_tensor.site_dim(), left_i, right_i, out_right_i, in_left_pb, out_right_pb);
             gemm(tmp, transpose(bra_conj), ret[b1]);
@@ -440,11 +431,7 @@ struct contraction {
         ket_tensor.make_right_paired();
         
         std::vector<block_matrix<Matrix, SymmGroup> > t(left.aux_dim());
-        std::size_t loop_max = left.aux_dim();
-
-        parallel_for(/*locale::scatter(mpo.placement_l)*/, std::size_t b = 0; b < loop_max; ++b) {
-            gemm_trim_left(transpose(left[b]), ket_tensor.data(), t[b]);
-        }
+        contraction_schedule::left_mult_mps(left, ket_tensor.data(), t);
 
         Index<SymmGroup> const & physical_i = ket_tensor.site_dim(),
                                & left_i = ket_tensor.row_dim(),
@@ -455,9 +442,11 @@ struct contraction {
                                 boost::lambda::bind(static_cast<charge(*)(charge, charge)>(SymmGroup::fuse),
                                         -boost::lambda::_1, boost::lambda::_2));
         
-        loop_max = mpo.col_dim();
+        std::size_t loop_max = mpo.col_dim();
+        std::vector<std::size_t> order = contraction_schedule::lbtm_order(mpo, t);
                     
-        parallel_for(/*locale::scatter(mpo.placement_r)*/, std::size_t b2 = 0; b2 < loop_max; ++b2) {
+        parallel_for(/*locale::scatter(mpo.placement_r)*/, std::size_t i = 0; i < loop_max; ++i) {
+            std::size_t b2 = order[i];
 
             block_matrix<Matrix, SymmGroup> contr_column = lbtm_kernel(b2, left, t, mpo, physical_i,
                                                                        right_i, out_left_i, in_right_pb, out_left_pb);
@@ -489,11 +478,7 @@ struct contraction {
         ket_tensor.make_right_paired();
         
         std::vector<block_matrix<Matrix, SymmGroup> > t(left.aux_dim());
-        std::size_t loop_max = left.aux_dim();
-        
-        parallel_for(/*locale::scatter(mpo.placement_l)*/, std::size_t b = 0; b < loop_max; ++b) {
-            gemm_trim_left(transpose(left[b]), ket_tensor.data(), t[b]);
-        }
+        contraction_schedule::left_mult_mps(left, ket_tensor.data(), t);
         
         Index<SymmGroup> const & physical_i = ket_tensor.site_dim(),
                                & left_i = bra_tensor.row_dim(),
@@ -504,9 +489,11 @@ struct contraction {
                                             boost::lambda::bind(static_cast<charge(*)(charge, charge)>(SymmGroup::fuse),
                                                                 -boost::lambda::_1, boost::lambda::_2));
         
-        loop_max = mpo.col_dim();
+        std::size_t loop_max = mpo.col_dim();
+        std::vector<std::size_t> order = contraction_schedule::lbtm_order(mpo, t);
         
-        parallel_for(/*locale::scatter(mpo.placement_r)*/, std::size_t b2 = 0; b2 < loop_max; ++b2) {
+        parallel_for(/*locale::scatter(mpo.placement_r)*/, std::size_t i = 0; i < loop_max; ++i) {
+            std::size_t b2 = order[i];
             
             block_matrix<Matrix, SymmGroup> contr_column = lbtm_kernel(b2, left, t, mpo, physical_i,
                                                                        right_i, out_left_i, in_right_pb, out_left_pb);
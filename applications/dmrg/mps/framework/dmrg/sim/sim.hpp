@@ -40,6 +40,7 @@ sim<Matrix, SymmGroup>::sim(DmrgParameters const & parms_)
 { 
     maquis::cout << DMRG_VERSION_STRING << std::endl;
     storage::setup(parms);
+    batched_gemm_threshold() = parms["gemm_batch_threshold"].as<double>();
     dmrg_random::engine.seed(parms["seed"]);
     
     {
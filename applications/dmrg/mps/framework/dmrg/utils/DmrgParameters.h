@@ -84,6 +84,9 @@ private:
         add_option("donotsave", "", value(0));
         add_option("run_seconds", "", value(0));
         add_option("storagedir", "", value(""));
+        add_option("storage_threads", "number of threads reading and writing the temporary storage", value(2));
+        add_option("gemm_batch_threshold", "block products with at least as many multiply-adds run one after the other on a threaded BLAS, smaller ones as parallel tasks", value(262144));
+        add_option("storage_compression", "compress the blocks in the temporary storage (needs zlib)", value(0));
         add_option("use_compressed", "", value(0));
         add_option("seed", "", value(42));
         add_option("ALWAYS_MEASURE", "comma separated list of measurements", value(""));
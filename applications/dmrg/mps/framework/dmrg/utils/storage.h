@@ -31,9 +31,19 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#ifdef MAQUIS_ZLIB
+#include <zlib.h>
+#endif
 
 #include <iostream>
 #include <fstream>
+#include <deque>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
 
 #include "utils.hpp"
 #include "utils/timings.h"
@@ -79,6 +89,65 @@ namespace storage {
         static void sync(){}
     };
 
+    namespace detail {
+        // Blocks are written column by column. With compression the bytes of
+        // the values are shuffled first (all first bytes, then all second
+        // bytes, ...), which groups the sign and exponent bytes, and the block
+        // is deflated at the fastest level.
+        template<class Matrix>
+        void write_block(std::ofstream& ofs, const Matrix& m, bool compress){
+            typedef typename Matrix::value_type value_type;
+            std::size_t rows = num_rows(m), cols = num_cols(m);
+#ifdef MAQUIS_ZLIB
+            if(compress && rows*cols > 0){
+                std::size_t n = rows*cols, s = sizeof(value_type);
+                std::vector<unsigned char> raw(n*s);
+                for(std::size_t c = 0; c < cols; ++c){
+                    const unsigned char* col = reinterpret_cast<const unsigned char*>(&m(0, c));
+                    for(std::size_t r = 0; r < rows; ++r)
+                    for(std::size_t j = 0; j < s; ++j)
+                        raw[j*n + c*rows + r] = col[r*s + j];
+                }
+                uLongf size = compressBound(raw.size());
+                std::vector<unsigned char> packed(size);
+                if(compress2(&packed[0], &size, &raw[0], raw.size(), Z_BEST_SPEED) != Z_OK)
+                    throw std::runtime_error("storage: compression of a block failed");
+                boost::uint64_t length = size;
+                ofs.write((char*)(&length), sizeof(length));
+                ofs.write((char*)(&packed[0]), size);
+                return;
+            }
+#endif
+            for (std::size_t c = 0; c < cols; ++c)
+                ofs.write((char*)(&m(0, c)), rows*sizeof(value_type)/sizeof(char));
+        }
+
+        // m has to be freshly allocated, i.e. contiguous
+        template<class Matrix>
+        void read_block(std::ifstream& ifs, Matrix& m, bool compress){
+            typedef typename Matrix::value_type value_type;
+            std::size_t n = num_rows(m)*num_cols(m);
+#ifdef MAQUIS_ZLIB
+            if(compress && n > 0){
+                std::size_t s = sizeof(value_type);
+                boost::uint64_t length;
+                ifs.read((char*)(&length), sizeof(length));
+                std::vector<unsigned char> packed(length), raw(n*s);
+                ifs.read((char*)(&packed[0]), length);
+                uLongf size = raw.size();
+                if(uncompress(&raw[0], &size, &packed[0], length) != Z_OK || size != raw.size())
+                    throw std::runtime_error("storage: decompression of a block failed");
+                unsigned char* out = reinterpret_cast<unsigned char*>(&m(0, 0));
+                for(std::size_t i = 0; i < n; ++i)
+                for(std::size_t j = 0; j < s; ++j)
+                    out[i*s + j] = raw[j*n + i];
+                return;
+            }
+#endif
+            ifs.read((char*)(&m(0,0)), n*sizeof(value_type)/sizeof(char));
+        }
+    }
+
     template<class T> class evict_request {};
     template<class T> class fetch_request {};
     template<class T> class drop_request {};
@@ -86,7 +155,7 @@ namespace storage {
     template<class Matrix, class SymmGroup>
     class evict_request< Boundary<Matrix, SymmGroup> > {
     public:
-        evict_request(std::string fp, Boundary<Matrix, SymmGroup>* ptr) : fp(fp), ptr(ptr) { }
+        evict_request(std::string fp, Boundary<Matrix, SymmGroup>* ptr, bool compress = false) : fp(fp), ptr(ptr), compress(compress) { }
         void operator()(){
             std::ofstream ofs(fp.c_str(), std::ofstream::binary);
             Boundary<Matrix, SymmGroup>& o = *ptr;
@@ -94,9 +163,7 @@ namespace storage {
             for(size_t b = 0; b < loop_max; ++b){
                 for (std::size_t k = 0; k < o[b].n_blocks(); ++k){
                     Matrix& m = o[b][k];
-                    for (std::size_t c = 0; c < num_cols(m); ++c)
-                        ofs.write((char*)(&m(0, c)), num_rows(m)*
-                                 sizeof(typename Matrix::value_type)/sizeof(char));
+                    detail::write_block(ofs, m, compress);
                     m = Matrix();
                 }
             }
@@ -105,12 +172,13 @@ namespace storage {
     private:
         std::string fp;
         Boundary<Matrix, SymmGroup>* ptr;
+        bool compress;
     };
 
     template<class Matrix, class SymmGroup>
     class fetch_request< Boundary<Matrix, SymmGroup> > {
     public:
-        fetch_request(std::string fp, Boundary<Matrix, SymmGroup>* ptr) : fp(fp), ptr(ptr) { }
+        fetch_request(std::string fp, Boundary<Matrix, SymmGroup>* ptr, bool compress = false) : fp(fp), ptr(ptr), compress(compress) { }
         void operator()(){
             std::ifstream ifs(fp.c_str(), std::ifstream::binary);
             Boundary<Matrix, SymmGroup>& o = *ptr;
@@ -119,9 +187,7 @@ namespace storage {
                 for (std::size_t k = 0; k < o[b].n_blocks(); ++k){
                     o[b][k] = Matrix(o[b].left_basis()[k].second,
                                      o[b].right_basis()[k].second);
-                    Matrix& m = o[b][k];
-                    ifs.read((char*)(&m(0,0)), num_cols(m)*num_rows(m)*
-                             sizeof(typename Matrix::value_type)/sizeof(char));
+                    detail::read_block(ifs, o[b][k], compress);
                 }
             }
             ifs.close();
@@ -129,6 +195,7 @@ namespace storage {
     private:
         std::string fp;
         Boundary<Matrix, SymmGroup>* ptr;
+        bool compress;
     };
 
     template<class Matrix, class SymmGroup>
@@ -147,31 +214,109 @@ namespace storage {
         Boundary<Matrix, SymmGroup>* ptr;
     };
 
+    // Fixed pool of I/O threads working on a queue of requests. Prefetches
+    // are put in front of the queue since a sweep step is going to wait for
+    // them, evictions are written whenever no prefetch is pending.
+    class io_pool {
+    public:
+        typedef boost::function<void()> job_type;
+
+        io_pool() : pending(0), stopped(false) {}
+       ~io_pool(){
+            this->stop();
+        }
+        void start(std::size_t n){
+            for(std::size_t i = 0; i < n; ++i)
+                threads.create_thread(boost::bind(&io_pool::run, this));
+        }
+        void stop(){
+            {
+                boost::mutex::scoped_lock lock(mutex);
+                stopped = true;
+            }
+            wakeup.notify_all();
+            threads.join_all();
+        }
+        void push(const job_type& job, bool urgent){
+            boost::mutex::scoped_lock lock(mutex);
+            if(urgent) jobs.push_front(job);
+            else jobs.push_back(job);
+            ++pending;
+            wakeup.notify_one();
+        }
+        void wait(){
+            boost::mutex::scoped_lock lock(mutex);
+            while(pending) done.wait(lock);
+        }
+        boost::mutex mutex;
+        boost::condition_variable done;
+    private:
+        void run(){
+            for(;;){
+                job_type job;
+                {
+                    boost::mutex::scoped_lock lock(mutex);
+                    while(jobs.empty() && !stopped) wakeup.wait(lock);
+                    if(jobs.empty()) return;
+                    job = jobs.front();
+                    jobs.pop_front();
+                }
+                job();
+                {
+                    boost::mutex::scoped_lock lock(mutex);
+                    --pending;
+                }
+                done.notify_all();
+            }
+        }
+        std::deque<job_type> jobs;
+        boost::thread_group threads;
+        boost::condition_variable wakeup;
+        std::size_t pending;
+        bool stopped;
+    };
+
     class disk : public nop {
     public:
         class descriptor {
         public:
-            descriptor() : state(core), dumped(false), sid(disk::index()), worker(NULL) {}
+            descriptor() : state(core), dumped(false), sid(disk::index()), busy(false) {}
+            descriptor(const descriptor& rhs) : state(rhs.state), dumped(rhs.dumped), sid(rhs.sid), busy(false) {}
            ~descriptor(){
                 this->join();
             }
-            void thread(boost::thread* t){
-                this->worker = t;
-                disk::track(this);
+            descriptor& operator = (const descriptor& rhs){
+                state = rhs.state;
+                dumped = rhs.dumped;
+                sid = rhs.sid;
+                return *this;
+            }
+            template<class Request> void submit(const Request& request, bool urgent){
+                this->join();
+                busy = true;
+                disk::instance().pool.push(task<Request>(request, this), urgent);
             }
             void join(){
-                if(this->worker){
-                    this->worker->join();
-                    delete this->worker;
-                    this->worker = NULL;
-                    disk::untrack(this);
-                }
+                boost::mutex::scoped_lock lock(disk::instance().pool.mutex);
+                while(busy) disk::instance().pool.done.wait(lock);
             }
             enum { core, storing, uncore, prefetching } state;
             bool dumped;
             size_t sid;
-            boost::thread* worker;
-            size_t record;
+            bool busy;
+        };
+
+        template<class Request> class task {
+        public:
+            task(const Request& request, descriptor* d) : request(request), d(d) { }
+            void operator()(){
+                request();
+                boost::mutex::scoped_lock lock(disk::instance().pool.mutex);
+                d->busy = false;
+            }
+        private:
+            Request request;
+            descriptor* d;
         };
 
         template<class T> class serializable : public descriptor {
@@ -194,14 +339,14 @@ namespace storage {
                 else if(this->state == storing) this->join();
 
                 state = prefetching;
-                this->thread(new boost::thread(fetch_request<T>(disk::fp(sid), (T*)this)));
+                this->submit(fetch_request<T>(disk::fp(sid), (T*)this, disk::compressed()), true);
             }
             void evict(){
                 if(state == core){
                     if(!dumped){
                         state = storing;
                         dumped = true;
-                        this->thread(new boost::thread(evict_request<T>(disk::fp(sid), (T*)this)));
+                        this->submit(evict_request<T>(disk::fp(sid), (T*)this, disk::compressed()), false);
                     }else{
                         state = uncore;
                         drop_request<T>(disk::fp(sid), (T*)this)();
@@ -222,31 +367,28 @@ namespace storage {
             static disk singleton;
             return singleton;
         }
-        static void init(const std::string& path){
-            maquis::cout << "Temporary storage enabled in " << path << "\n";
+        static void init(const std::string& path, std::size_t threads = 1, bool compress = false){
+            maquis::cout << "Temporary storage enabled in " << path << " (" << threads << " I/O threads"
+                         << (compress ? ", compressed" : "") << ")\n";
             instance().active = true;
             instance().path = path;
+            instance().compress = compress;
+            instance().pool.start(std::max<std::size_t>(threads, 1));
         }
         static bool enabled(){
             return instance().active;
         }
+        static bool compressed(){
+            return instance().compress;
+        }
         static std::string fp(size_t sid){
             return (instance().path + boost::lexical_cast<std::string>(sid));
         }
         static size_t index(){
             return instance().sid++;
         }
-        static void track(descriptor* d){ 
-            d->record = instance().queue.size();
-            instance().queue.push_back(d);
-        }
-        static void untrack(descriptor* d){ 
-            instance().queue[d->record] = NULL;
-        }
         static void sync(){
-            for(int i = 0; i < instance().queue.size(); ++i)
-                if(instance().queue[i]) instance().queue[i]->join();
-            instance().queue.clear();
+            instance().pool.wait();
         }
         template<class T> static void fetch(serializable<T>& t)   { if(enabled()) t.fetch();    }
         template<class T> static void prefetch(serializable<T>& t){ if(enabled()) t.prefetch(); }
@@ -257,10 +399,11 @@ namespace storage {
         template<class Matrix, class SymmGroup> 
         static void evict(MPSTensor<Matrix, SymmGroup>& t){ }
 
-        disk() : active(false), sid(0) {}
-        std::vector<descriptor*> queue;
+        disk() : active(false), compress(false), sid(0) {}
+        io_pool pool;
         std::string path;
         bool active; 
+        bool compress;
         size_t sid;
     };
 
@@ -273,7 +416,12 @@ namespace storage {
                 maquis::cerr << "Error creating dir/file at " << dp << ". Try different 'storagedir'.\n";
                 throw;
             }
-            storage::disk::init(dp.string());
+            bool compress = parms["storage_compression"];
+#ifndef MAQUIS_ZLIB
+            if(compress) maquis::cerr << "Compression of the temporary storage needs zlib, storing uncompressed.\n";
+            compress = false;
+#endif
+            storage::disk::init(dp.string(), parms["storage_threads"], compress);
         }else{
             maquis::cout << "Temporary storage is disabled\n";
         }
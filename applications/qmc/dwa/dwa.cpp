@@ -206,6 +206,8 @@ directed_worm_algorithm
     _neighbortimes_cache.reserve(maximum_num_neighbors);
     _neighbortaus_cache.reserve(maximum_num_neighbors);
 
+    initialize_neighbor_selection();
+
     // print to screen
     print_simulation (std::cout);
 #ifdef DEBUGMODE
@@ -838,6 +840,31 @@ double directed_worm_algorithm::hopping_energy (bond_descriptor const & bond_, u
     return (increasing_ ? (bond_strength_matrix[index(bond_)] * site_oneup_matrix[site_site_type[target(bond_)]][targetstate_] * site_onedown_matrix[site_site_type[target(bond_)]][targetstate_+1]) : (bond_strength_matrix[index(bond_)] * site_onedown_matrix[site_site_type[target(bond_)]][targetstate_] * site_oneup_matrix[site_site_type[target(bond_)]][targetstate_-1]));
 }
 
+// The worm head proposes a neighbor bond with probability proportional to its
+// bond strength, such that weak long-range bonds are rarely tried. The
+// proposal of the reverse move is made from the same site, so that the ratio
+// of the proposal probabilities cancels except for relinking a vertex, where
+// the bond strengths of the old and the new bond enter the acceptance. If all
+// neighbor bonds of a site are equally strong, the bond is chosen uniformly.
+void directed_worm_algorithm::initialize_neighbor_selection()
+{
+    _uniform_neighborbonds.assign(num_sites(), true);
+    _neighborbond_choice.resize(num_sites());
+    for (site_iterator it=sites().first; it!=sites().second; ++it)
+    {
+        std::vector<double> _strengths;
+        _strengths.reserve(num_neighbors(*it));
+        for (neighbor_bond_iterator _neighborbondit=neighbor_bonds(*it).first; _neighborbondit!=neighbor_bonds(*it).second; ++_neighborbondit)
+        {
+            _strengths.push_back(bond_strength_matrix[index(*_neighborbondit)]);
+            if (_strengths.back() != _strengths.front())
+                _uniform_neighborbonds[*it] = false;
+        }
+        if (!_uniform_neighborbonds[*it])
+            _neighborbond_choice[*it] = alps::random_choice<double>(_strengths);
+    }
+}
+
 void
   directed_worm_algorithm
     ::dostep()
@@ -1359,7 +1386,7 @@ void
     ::insert_jump_or_bounce (double const diagonal_energy_relative_, std::pair<neighbor_iterator,neighbor_iterator> const & neighbors_)
     {
 #ifndef HEATBATH_ALGORITHM
-      neighbor_bond_iterator it=neighbor_bonds(worm.site()).first + random()*num_neighbors(worm.site());
+      neighbor_bond_iterator it=random_neighbor_bond(worm.site());
       location_type _neighborlocation  = wl.location(target(*it), worm.time());
       const unsigned short _targetstate = (_neighborlocation.second-1)->state();
       if (  ( worm.increasing() && _targetstate == state_maximum[site_site_type[target(*it)]])
@@ -1460,10 +1487,12 @@ void
       const std::pair<neighbor_bond_iterator, neighbor_bond_iterator> _neighbor_bonds = neighbor_bonds(worm.next_partnersite());
 
       double _weight = 0;
+      double _strength = 0;
       for (neighbor_bond_iterator it=_neighbor_bonds.first; it!=_neighbor_bonds.second; ++it)
         if (target(*it) == worm.site())
         {
           _weight = hopping_energy(*it, (wl.location(target(*it), worm.next_time()).second-1)->state(), !worm.increasing());
+          _strength = bond_strength_matrix[index(*it)];
           break;
         }
 
@@ -1476,7 +1505,7 @@ void
       }
 #endif
      
-      neighbor_bond_iterator it=_neighbor_bonds.first + random()*num_neighbors(worm.next_partnersite());
+      neighbor_bond_iterator it=random_neighbor_bond(worm.next_partnersite());
 
       if (target(*it) == worm.site())    // delete vertex or bounce
       {
@@ -1525,7 +1554,9 @@ void
         }
         else
         {
-          const double _weight_new = hopping_energy(*it, _targetstate, _increasing);
+          double _weight_new = hopping_energy(*it, _targetstate, _increasing);
+          if (!_uniform_neighborbonds[worm.next_partnersite()])    // ratio of the proposal probabilities
+            _weight_new *= _strength / bond_strength_matrix[index(*it)];
 
 #ifdef DEBUGMODE
           if (_sweep_counter == DEBUG_SWEEP_COUNTER)
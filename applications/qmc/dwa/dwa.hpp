@@ -52,6 +52,7 @@
 #include <alps/numeric/vector_functions.hpp>
 #include <alps/numeric/vector_valarray_conversion.hpp>
 #include <alps/ngs.hpp>
+#include <alps/random/random_choice.hpp>
 
 #include "worldlines.hpp"
 
@@ -115,6 +116,11 @@ private:
 
     double hopping_energy (bond_descriptor const & bond_, unsigned short targetstate_, bool increasing_) const;
 
+    // regarding neighbor selection
+    void initialize_neighbor_selection();
+    neighbor_bond_iterator random_neighbor_bond (unsigned int site_)
+    { return neighbor_bonds(site_).first + (_uniform_neighborbonds[site_] ? static_cast<unsigned int>(random()*num_neighbors(site_)) : _neighborbond_choice[site_](random)); }
+
     std::vector<double> onsite_energies (std::vector<unsigned short> const & states_) const
     {
         std::vector<double> _onsite_energies;
@@ -243,5 +249,9 @@ private:
     std::vector<unsigned short>   _neighborstates_cache;
     std::vector<double>           _neighbortimes_cache;
     std::vector<double>           _neighbortaus_cache;
+
+    // regarding neighbor selection (proposal of neighbor bonds proportional to the bond strength)
+    std::vector<bool>                        _uniform_neighborbonds;   // all neighbor bonds of the site are equally strong
+    std::vector<alps::random_choice<double> > _neighborbond_choice;     // alias table of the bond strengths, unused for uniform sites
 };
 #endif
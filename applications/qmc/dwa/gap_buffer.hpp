@@ -0,0 +1,185 @@
+/*****************************************************************************
+*
+* ALPS Project Applications: Directed Worm Algorithm
+*
+* Copyright (C) 2013 - 2016
+*                   by  Matthias Troyer  <troyer@phys.ethz.ch> ,
+*                       Lode Pollet      <pollet@phys.ethz.ch> ,
+*                       Ping Nang Ma     <tamama@phys.ethz.ch>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+*
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+#ifndef GAP_BUFFER_HPP
+#define GAP_BUFFER_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include <boost/iterator/iterator_facade.hpp>
+
+// ==================================================
+// gap_buffer class
+// ==================================================
+//
+// A sequence with the interface of std::vector that keeps an unused gap
+// inside its storage. Inserting or erasing at position i moves the gap to i
+// first, which copies only the elements between the old and the new gap
+// position. The worm inserts and erases kinks next to its head, so that the
+// gap follows the head and each update moves a few kinks instead of all
+// kinks behind the insertion point.
+//
+// Iterators store the logical position of an element. As for std::vector,
+// insert and erase invalidate iterators at and after the modified position,
+// but moving the gap does not invalidate any iterator.
+
+template <class Buffer, class T>
+class gap_buffer_iterator
+  : public boost::iterator_facade<gap_buffer_iterator<Buffer,T>, T, boost::random_access_traversal_tag, T&, std::ptrdiff_t>
+{
+public:
+  gap_buffer_iterator() : _buffer(0), _index(0) {}
+  gap_buffer_iterator(Buffer * buffer_, std::size_t index_) : _buffer(buffer_), _index(index_) {}
+
+  // iterator to const_iterator conversion
+  template <class Buffer2, class T2>
+  gap_buffer_iterator(gap_buffer_iterator<Buffer2,T2> const & other_) : _buffer(other_._buffer), _index(other_._index) {}
+
+  std::size_t index() const  { return _index; }
+
+private:
+  friend class boost::iterator_core_access;
+  template <class, class> friend class gap_buffer_iterator;
+
+  T &  dereference() const  { return (*_buffer)[_index]; }
+  template <class Buffer2, class T2>
+  bool equal(gap_buffer_iterator<Buffer2,T2> const & other_) const  { return _index == other_._index; }
+  void increment()  { ++_index; }
+  void decrement()  { --_index; }
+  void advance(std::ptrdiff_t n_)  { _index += n_; }
+  template <class Buffer2, class T2>
+  std::ptrdiff_t distance_to(gap_buffer_iterator<Buffer2,T2> const & other_) const  { return std::ptrdiff_t(other_._index) - std::ptrdiff_t(_index); }
+
+  Buffer *    _buffer;
+  std::size_t _index;
+};
+
+template <class T>
+class gap_buffer
+{
+public:
+  typedef T                 value_type;
+  typedef T &               reference;
+  typedef T const &         const_reference;
+  typedef std::size_t       size_type;
+  typedef std::ptrdiff_t    difference_type;
+  typedef gap_buffer_iterator<gap_buffer, T>                  iterator;
+  typedef gap_buffer_iterator<gap_buffer const, T const>      const_iterator;
+
+  gap_buffer() : _gap_begin(0), _gap_end(0) {}
+
+  size_type size()     const  { return _data.size() - (_gap_end - _gap_begin); }
+  size_type capacity() const  { return _data.size(); }
+  bool      empty()    const  { return size() == 0; }
+
+  reference       operator[](size_type i_)        { return _data[i_ < _gap_begin ? i_ : i_ + (_gap_end - _gap_begin)]; }
+  const_reference operator[](size_type i_) const  { return _data[i_ < _gap_begin ? i_ : i_ + (_gap_end - _gap_begin)]; }
+
+  reference       front()        { return (*this)[0]; }
+  const_reference front() const  { return (*this)[0]; }
+  reference       back()         { return (*this)[size()-1]; }
+  const_reference back()  const  { return (*this)[size()-1]; }
+
+  iterator       begin()        { return iterator(this, 0); }
+  iterator       end()          { return iterator(this, size()); }
+  const_iterator begin() const  { return const_iterator(this, 0); }
+  const_iterator end()   const  { return const_iterator(this, size()); }
+
+  void reserve(size_type n_)  { if (n_ > capacity()) reallocate(n_, _gap_begin); }
+  void clear()  { _data.clear(); _gap_begin = _gap_end = 0; }
+
+  void push_back(T const & value_)  { insert(end(), value_); }
+
+  iterator insert(iterator position_, T const & value_)
+  {
+    const size_type _index = position_.index();
+    if (_gap_begin == _gap_end)
+      reallocate(std::max<size_type>(2*capacity(), 16), _index);
+    else
+      move_gap(_index);
+    _data[_gap_begin++] = value_;
+    return iterator(this, _index);
+  }
+
+  iterator erase(iterator position_)
+  {
+    const size_type _index = position_.index();
+    if (_index < _gap_begin) {
+      move_gap(_index+1);
+      --_gap_begin;
+    }
+    else {
+      move_gap(_index);
+      ++_gap_end;
+    }
+    return iterator(this, _index);
+  }
+
+  void swap(gap_buffer & other_)
+  {
+    _data.swap(other_._data);
+    std::swap(_gap_begin, other_._gap_begin);
+    std::swap(_gap_end, other_._gap_end);
+  }
+
+private:
+  // moves the gap such that it starts before the element at logical position index_
+  void move_gap(size_type index_)
+  {
+    if (index_ < _gap_begin) {
+      std::copy_backward(_data.begin()+index_, _data.begin()+_gap_begin, _data.begin()+_gap_end);
+      _gap_end  -= _gap_begin - index_;
+      _gap_begin = index_;
+    }
+    else if (index_ > _gap_begin) {
+      const size_type _shift = index_ - _gap_begin;
+      std::copy(_data.begin()+_gap_end, _data.begin()+_gap_end+_shift, _data.begin()+_gap_begin);
+      _gap_begin += _shift;
+      _gap_end   += _shift;
+    }
+  }
+
+  // copies the elements into new storage of size capacity_ with the gap at logical position index_
+  void reallocate(size_type capacity_, size_type index_)
+  {
+    move_gap(index_);
+    std::vector<T> _new_data(capacity_);
+    const size_type _tail = _data.size() - _gap_end;
+    std::copy(_data.begin(), _data.begin()+_gap_begin, _new_data.begin());
+    std::copy(_data.begin()+_gap_end, _data.end(), _new_data.end()-_tail);
+    _data.swap(_new_data);
+    _gap_end = _data.size() - _tail;
+  }
+
+  std::vector<T> _data;
+  size_type      _gap_begin;  // logical position of the gap
+  size_type      _gap_end;    // storage index of the first element after the gap
+};
+
+#endif
@@ -0,0 +1,143 @@
+/*****************************************************************************
+*
+* ALPS Project Applications: Directed Worm Algorithm
+*
+* Copyright (C) 2013 - 2016
+*                   by  Matthias Troyer  <troyer@phys.ethz.ch> ,
+*                       Lode Pollet      <pollet@phys.ethz.ch> ,
+*                       Ping Nang Ma     <tamama@phys.ethz.ch>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+*
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+// Checks gap_buffer against std::vector for random inserts and erases, and
+// that iterators before the modified position stay valid when the gap moves
+// or the storage is reallocated.
+
+#include "gap_buffer.hpp"
+
+#include <iostream>
+#include <vector>
+
+// small linear congruential generator, so that the sequence of operations is the same everywhere
+class lcg
+{
+public:
+  lcg() : _state(4711) {}
+  unsigned int operator()(unsigned int n_)  { _state = _state * 1103515245u + 12345u; return (_state >> 8) % n_; }
+private:
+  unsigned int _state;
+};
+
+bool same(gap_buffer<int> const & buffer_, std::vector<int> const & reference_)
+{
+  if (buffer_.size() != reference_.size() || buffer_.end() - buffer_.begin() != std::ptrdiff_t(reference_.size()))
+    return false;
+  for (std::size_t i=0; i < reference_.size(); ++i)
+    if (buffer_[i] != reference_[i] || *(buffer_.begin()+i) != reference_[i])
+      return false;
+  return true;
+}
+
+int main()
+{
+  int failures = 0;
+
+  // random inserts and erases, positions near the last one as in the worm update
+  {
+    gap_buffer<int> buffer;
+    std::vector<int> reference;
+    lcg random;
+    std::size_t position = 0;
+    for (int step=0; step < 20000; ++step) {
+      if (random(3) == 0)
+        position = random(reference.size()+1);
+      else
+        position = std::min<std::size_t>(position + random(5), reference.size());
+      if (reference.empty() || random(5) < 3) {
+        gap_buffer<int>::iterator it = buffer.insert(buffer.begin()+position, step);
+        reference.insert(reference.begin()+position, step);
+        if (it - buffer.begin() != std::ptrdiff_t(position) || *it != step)
+          ++failures;
+      }
+      else {
+        if (position == reference.size())
+          --position;
+        gap_buffer<int>::iterator it = buffer.erase(buffer.begin()+position);
+        reference.erase(reference.begin()+position);
+        if (it - buffer.begin() != std::ptrdiff_t(position) || (it != buffer.end() && *it != reference[position]))
+          ++failures;
+      }
+      if (!same(buffer, reference))
+        ++failures;
+    }
+    std::cout << "random inserts and erases: " << reference.size() << " elements, "
+              << failures << " failures" << std::endl;
+  }
+
+  // iterators before the modified position, and the elements they point to, are unchanged
+  {
+    int stale = 0;
+    gap_buffer<int> buffer;
+    for (int i=0; i < 8; ++i)
+      buffer.push_back(i);
+    gap_buffer<int>::iterator first = buffer.begin() + 2;
+    gap_buffer<int>::const_iterator second = buffer.begin() + 5;
+    std::size_t const capacity = buffer.capacity();
+    // inserting at the end moves the gap away from the iterators and eventually reallocates
+    for (int i=0; i < 100; ++i) {
+      buffer.insert(buffer.end(), 100+i);
+      if (*first != 2 || *second != 5)
+        ++stale;
+    }
+    // inserting and erasing behind the iterators moves the gap back and forth over them
+    for (int i=0; i < 50; ++i) {
+      buffer.insert(buffer.begin()+6+i, 200+i);
+      buffer.erase(buffer.end()-1);
+      buffer.insert(buffer.begin()+buffer.size()/2, 300+i);
+      buffer.erase(buffer.begin()+7);
+      if (*first != 2 || *second != 5)
+        ++stale;
+    }
+    std::cout << "iterators: capacity " << capacity << " -> " << buffer.capacity()
+              << ", " << stale << " stale" << std::endl;
+    failures += stale;
+  }
+
+  // reserve and swap keep the contents
+  {
+    gap_buffer<int> buffer, other;
+    std::vector<int> reference;
+    for (int i=0; i < 10; ++i) {
+      buffer.insert(buffer.begin()+i/2, i);
+      reference.insert(reference.begin()+i/2, i);
+    }
+    buffer.reserve(1000);
+    bool ok = same(buffer, reference) && buffer.capacity() >= 1000;
+    buffer.swap(other);
+    ok = ok && buffer.empty() && same(other, reference);
+    other.clear();
+    ok = ok && other.empty();
+    std::cout << "reserve, swap and clear: " << (ok ? "ok" : "failed") << std::endl;
+    if (!ok)
+      ++failures;
+  }
+
+  return failures ? -1 : 0;
+}
@@ -42,6 +42,10 @@
 #include <boost/tuple/tuple.hpp>
 #include <alps/hdf5.hpp>
 
+#ifdef GAP_BUFFER_WORLDLINES
+#include "gap_buffer.hpp"
+#endif
+
 // ==================================================
 // kink class
 // ==================================================
@@ -107,10 +111,18 @@ void kink::load(alps::hdf5::archive & ar)
 // worldlines class
 // ==================================================
 
+// The kinks of a site are kept in time order in a std::vector by default.
+// Configure with -DALPS_DWA_GAP_BUFFER=ON, which defines GAP_BUFFER_WORLDLINES,
+// to store them in a gap_buffer instead, which is faster if a site holds many kinks.
+
 class worldlines
 {
 public:
+#ifdef GAP_BUFFER_WORLDLINES
+  typedef gap_buffer<kink>  line;
+#else
   typedef std::vector<kink> line;
+#endif
   typedef std::vector<line> lines;
   typedef std::pair<lines::iterator, line::iterator>   location_type;
 
@@ -284,8 +296,17 @@ std::ostream & operator<<(std::ostream & out, worldlines const & obj_)
 
 void worldlines::save_old1(alps::hdf5::archive & ar) const
 {
-  ar << alps::make_pvp("/simulation/worldlines/num_sites"  , num_sites())
-     << alps::make_pvp("/simulation/worldlines/worldlines" , _worldlines);
+  ar << alps::make_pvp("/simulation/worldlines/num_sites"  , num_sites());
+#ifdef GAP_BUFFER_WORLDLINES
+  // the archive stores the lines as vectors
+  std::vector<std::vector<kink> > _lines;
+  _lines.reserve(num_sites());
+  for (lines::const_iterator it=_worldlines.begin(); it!=_worldlines.end(); ++it)
+    _lines.push_back(std::vector<kink>(it->begin(), it->end()));
+  ar << alps::make_pvp("/simulation/worldlines/worldlines" , _lines);
+#else
+  ar << alps::make_pvp("/simulation/worldlines/worldlines" , _worldlines);
+#endif
 }
 
 void worldlines::load_old1(alps::hdf5::archive & ar)
@@ -296,7 +317,19 @@ void worldlines::load_old1(alps::hdf5::archive & ar)
   if (num_sites() != _archive_num_sites)
     boost::throw_exception(std::runtime_error("Error in loading worldline object. Reason: wrong data structure."));
 
+#ifdef GAP_BUFFER_WORLDLINES
+  std::vector<std::vector<kink> > _lines;
+  ar >> alps::make_pvp("/simulation/worldlines/worldlines" , _lines);
+
+  for (unsigned int i=0; i<num_sites(); ++i) {
+    _worldlines[i].clear();
+    _worldlines[i].reserve(2*_lines[i].size());
+    for (std::vector<kink>::const_iterator it=_lines[i].begin(); it!=_lines[i].end(); ++it)
+      _worldlines[i].push_back(*it);
+  }
+#else
   ar >> alps::make_pvp("/simulation/worldlines/worldlines" , _worldlines);
+#endif
 }
 
 void worldlines::save(alps::hdf5::archive & ar) const
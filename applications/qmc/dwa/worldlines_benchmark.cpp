@@ -0,0 +1,107 @@
+/*****************************************************************************
+*
+* ALPS Project Applications: Directed Worm Algorithm
+*
+* Copyright (C) 2013 - 2016
+*                   by  Matthias Troyer  <troyer@phys.ethz.ch> ,
+*                       Lode Pollet      <pollet@phys.ethz.ch> ,
+*                       Ping Nang Ma     <tamama@phys.ethz.ch>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+*
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+// Compares std::vector and gap_buffer as the kink container of a worldline.
+// A worm head walks along a single line with a given number of kinks and
+// at each update either crosses the next kink, inserts a vertex in front of
+// it or deletes it, as in the worm propagation of dwa. A new worm is started
+// at a random time every worm_length updates.
+//
+// usage: dwa_worldlines_benchmark [number of updates] [worm length]
+
+#include "worldlines.hpp"
+#include "gap_buffer.hpp"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_01.hpp>
+
+bool same_kink(kink const & kink1_, kink const & kink2_)
+{
+  return kink1_.siteindicator() == kink2_.siteindicator() && kink1_.time() == kink2_.time() && kink1_.state() == kink2_.state();
+}
+
+template <class Line>
+double run(Line & line, unsigned int num_kinks, unsigned long num_updates, unsigned long worm_length)
+{
+  boost::mt19937 eng(4711);
+  boost::uniform_01<boost::mt19937 &> rng(eng);
+
+  line.push_back(kink(0));
+  for (unsigned int i=1; i <= num_kinks; ++i)
+    line.push_back(kink(1, double(i)/(num_kinks+1), i%2));
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  typename Line::iterator head = line.begin()+1;
+  for (unsigned long n=0; n < num_updates; ++n)
+  {
+    if (n % worm_length == 0)
+    {
+      head = std::lower_bound(line.begin()+1, line.end(), rng());
+      continue;
+    }
+    const double r = rng();
+    if (head == line.end())
+      head = line.begin()+1;
+    if (r < 1./3 || line.size() == 1)         // crosses the next kink
+      ++head;
+    else if (r < 2./3)                        // inserts a vertex before the next kink
+    {
+      const double _time = 0.5 * ((head-1)->time() + (head == line.end() ? 1. : head->time()));
+      head = line.insert(head, kink(1, _time, (head-1)->state() ^ 1));
+      ++head;
+    }
+    else if (head != line.end())              // deletes the next kink
+      head = line.erase(head);
+  }
+  return (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() * 1e-6;
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long num_updates = argc > 1 ? boost::lexical_cast<unsigned long>(argv[1]) : 2000000;
+  unsigned long worm_length = argc > 2 ? boost::lexical_cast<unsigned long>(argv[2]) : 100;
+
+  std::cout << "updates: " << num_updates << ", worm length: " << worm_length << "\n";
+  std::cout << "kinks\tvector [updates/s]\tgap_buffer [updates/s]\tspeedup\n";
+  for (unsigned int num_kinks=16; num_kinks <= 65536; num_kinks *= 4)
+  {
+    std::vector<kink> vector_line;
+    gap_buffer<kink>  gap_buffer_line;
+    double t_vector     = run(vector_line, num_kinks, num_updates, worm_length);
+    double t_gap_buffer = run(gap_buffer_line, num_kinks, num_updates, worm_length);
+    std::cout << num_kinks << "\t" << num_updates / t_vector << "\t" << num_updates / t_gap_buffer
+              << "\t" << t_vector / t_gap_buffer << "\n";
+
+    if (vector_line.size() != gap_buffer_line.size() || !std::equal(vector_line.begin(), vector_line.end(), gap_buffer_line.begin(), same_kink))
+    {
+      std::cerr << "worldlines differ for " << num_kinks << " kinks\n";
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -46,10 +46,6 @@ struct Vertex
     leg[1]=v.leg[1];
     leg[2]=v.leg[2];
     leg[3]=v.leg[3];
-    linked_vertices[0]=v.linked_vertices[0];
-    linked_vertices[1]=v.linked_vertices[1];
-    linked_vertices[2]=v.linked_vertices[2];
-    linked_vertices[3]=v.linked_vertices[3];
   }
 
   Vertex const& operator=(Vertex const& v) 
@@ -60,10 +56,6 @@ struct Vertex
     leg[1]=v.leg[1];
     leg[2]=v.leg[2];
     leg[3]=v.leg[3];
-    linked_vertices[0]=v.linked_vertices[0];
-    linked_vertices[1]=v.linked_vertices[1];
-    linked_vertices[2]=v.linked_vertices[2];
-    linked_vertices[3]=v.linked_vertices[3];
     return *this;
   }
 
@@ -85,11 +77,10 @@ struct Vertex
 
   // States at the four legs
   state_type leg[4]; // 0=down left,1=down right,2=up left,3=up right
-  
-  // The vertices linked to the current one
-  // uint32_t is the vertex number in Operator String
-  // bool specifies whether it is target's left or right leg
-  std::pair < alps::uint32_t, bool > linked_vertices[4];
+
+  // The links between the legs of the vertices are only needed by the worm
+  // and are stored separately in SSE::leg_links, which keeps the vertices
+  // small for the diagonal update and for copies of the operator string
 
   bool identity() { return (vertex_type==0); }
   bool diagonal() { return (vertex_type==1); }
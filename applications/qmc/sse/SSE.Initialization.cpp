@@ -306,6 +306,34 @@ void SSE::initialize_diagonal_update_probabilities()
         proba_diagonal[i][l1][l2]=std::fabs(matrix_element[i][l1][l2][l1][l2])*num_bonds()*beta;
 }
 
+// Copy the probabilities into the flat tables used by the update loops
+void SSE::initialize_update_tables()
+{
+  std::size_t S=maximum_number_of_states;
+  diagonal_table.assign(number_of_bond_types*S*S,0.);
+  exit_leg_table.assign(number_of_bond_types*S*S*S*S*16,0.);
+  for (alps::uint32_t i=0;i<number_of_bond_types;++i)
+    for (std::size_t l0=0;l0<S;++l0)
+      for (std::size_t l1=0;l1<S;++l1) {
+        diagonal_table[(i*S+l0)*S+l1]=proba_diagonal[i][l0][l1];
+        for (std::size_t l2=0;l2<S;++l2)
+          for (std::size_t l3=0;l3<S;++l3)
+            for (std::size_t inc=0;inc<4;++inc)
+              for (std::size_t out=0;out<4;++out)
+                exit_leg_table[(((((i*S+l0)*S+l1)*S+l2)*S+l3)*4+inc)*4+out]=
+                  proba_worm[i][l0][l1][l2][l3][out][inc];
+      }
+
+  bond_type_table.resize(num_bonds());
+  bond_source_table.resize(num_bonds());
+  bond_target_table.resize(num_bonds());
+  for (alps::uint32_t b=0;b<num_bonds();++b) {
+    bond_type_table[b]=bond_type[bond(b)];
+    bond_source_table[b]=source(bond(b));
+    bond_target_table[b]=target(bond(b));
+  }
+}
+
 // Initalisation functions
 void SSE::initialize_simulation()
 {
@@ -315,6 +343,7 @@ void SSE::initialize_simulation()
   determine_bonds_offset();
   initialize_diagonal_update_probabilities();
   calculate_proba_worm(); 
+  initialize_update_tables();
   
   print_arrays();
   total_shift=0.;
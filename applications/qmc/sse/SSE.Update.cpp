@@ -58,23 +58,24 @@ void SSE::diagonal_update()
         double proba=0.;
         // Get a random bond
         alps::uint32_t random_bond=random_int(0,num_bonds()-1);
-        bond_descriptor this_bond=bond(random_bond);
+        state_type s0=states[bond_source_table[random_bond]];
+        state_type s1=states[bond_target_table[random_bond]];
 
         // Get the insertion probability at this bond
-        proba=proba_diagonal[bond_type[this_bond]][states[source(this_bond)]][states[target(this_bond)]]/(cutoff_L-current_number_of_non_identity);
+        proba=diagonal_table[(bond_type_table[random_bond]*maximum_number_of_states+s0)*maximum_number_of_states+s1]/(cutoff_L-current_number_of_non_identity);
         
         if (proba!=0. && (proba>=1. || random_real()<proba)) {
           // Insert a diagonal element
           ++current_number_of_non_identity;
           it->vertex_type=1;
           it->bond_number=random_bond;
-          it->leg[0]=it->leg[2]=states[source(this_bond)]; 
-          it->leg[1]=it->leg[3]=states[target(this_bond)]; 
+          it->leg[0]=it->leg[2]=s0; 
+          it->leg[1]=it->leg[3]=s1; 
         }
       }
       else { // Diagonal
         // Get the removal probability
-        double proba=(cutoff_L-current_number_of_non_identity+1) / proba_diagonal[bond_type[bond(it->bond_number)]][it->leg[0]][it->leg[1]];
+        double proba=(cutoff_L-current_number_of_non_identity+1) / diagonal_table[(bond_type_table[it->bond_number]*maximum_number_of_states+it->leg[0])*maximum_number_of_states+it->leg[1]];
         if ( proba>=1 || random_real()<proba ) {
           // Remove it
           --current_number_of_non_identity;
@@ -85,8 +86,8 @@ void SSE::diagonal_update()
       }
     }
     else { // Non-Diagonal
-      int s=source(bond(it->bond_number));
-      int t=target(bond(it->bond_number));
+      int s=bond_source_table[it->bond_number];
+      int t=bond_target_table[it->bond_number];
       if (measure_site_compressibility_) {
         if (last_level[s]!=std::numeric_limits<unsigned int>::max BOOST_PREVENT_MACRO_SUBSTITUTION ()) {
           localint[s]+=(level-last_level[s])*(matrix_element_n[site_type(s)][states[s]]-initm[s]);
@@ -119,6 +120,7 @@ void SSE::link_legs()
   // for each site, the first vertex sitting there
   // A value of cutoff_L indicates no vertex at this site (for the moment)
   vector<alps::uint32_t> first_vertex(num_sites(),cutoff_L);
+  leg_links.resize(4*operator_string.size());
   
   std::vector<vertex_type>::iterator it; 
   alps::uint32_t i=0;
@@ -128,7 +130,7 @@ void SSE::link_legs()
     if (!(it->identity())) { // Non-Identity vertices
       for (state_type rr=0;rr<2;++rr) { // For both legs 
         // Get the site on which this vertex sits
-        sites_size_type site = rr ? target(bond(it->bond_number)) : source (bond(it->bond_number));
+        sites_size_type site = rr ? bond_target_table[it->bond_number] : bond_source_table[it->bond_number];
         
         if (current_vertex[site]==cutoff_L)
           // First vertex on this site
@@ -138,11 +140,11 @@ void SSE::link_legs()
           alps::uint32_t previous_vertex=current_vertex[site];         
           // This boolean indicates if it was previous vertex' left (0) or 
           // right (leg) at this site
-          bool previous_vertex_first_leg=(source(bond(operator_string[previous_vertex].bond_number))!=site);
+          bool previous_vertex_first_leg=(bond_source_table[operator_string[previous_vertex].bond_number]!=site);
           // Link the previous vertex' top legs to the current one
-          operator_string[previous_vertex].linked_vertices[2+previous_vertex_first_leg]=make_pair(i,bool(rr)); 
+          leg_links[4*previous_vertex+2+previous_vertex_first_leg]=make_pair(i,bool(rr)); 
           // Link the current vertex' bottom leg to the previous one
-          it->linked_vertices[rr]=make_pair(previous_vertex,previous_vertex_first_leg);
+          leg_links[4*i+rr]=make_pair(previous_vertex,previous_vertex_first_leg);
           
         }
         // Put this vertex as the current vertex on this site
@@ -158,10 +160,10 @@ void SSE::link_legs()
     if (current_vertex[ii]!=cutoff_L) { 
       alps::uint32_t last = current_vertex[ii];
       alps::uint32_t first = first_vertex[ii];
-      bool last_legs  = (source(bond(operator_string[last].bond_number))!=ii);
-      bool first_legs = (source(bond(operator_string[first].bond_number))!=ii);
-      operator_string[last].linked_vertices[2+last_legs]=make_pair(first,first_legs);
-      operator_string[first].linked_vertices[first_legs]=make_pair(last,last_legs);
+      bool last_legs  = (bond_source_table[operator_string[last].bond_number]!=ii);
+      bool first_legs = (bond_source_table[operator_string[first].bond_number]!=ii);
+      leg_links[4*last+2+last_legs]=make_pair(first,first_legs);
+      leg_links[4*first+first_legs]=make_pair(last,last_legs);
     }
     else // There was no vertex on this site - Pick a random state
       site_state[ii]=random_int(0,site_number_of_states[ii]-1);
@@ -177,7 +179,7 @@ void SSE::print_operator_string()
       cout << "vertex_type " << i << " between [" << source(bond(it->bond_number)) 
            << ", " << target(bond(it->bond_number)) << "] : ";
       for (state_type rr=0;rr<4;++rr)
-           cout << "Links " << rr << "={ "<< it->linked_vertices[rr].first << "," <<  it->linked_vertices[rr].second << "} ";
+           cout << "Links " << rr << "={ "<< leg_links[4*i+rr].first << "," <<  leg_links[4*i+rr].second << "} ";
       cout << "\nState legs ";  
       for (state_type rr=0;rr<4;++rr)
         cout << (int) it->leg[rr] << " ";
@@ -409,15 +411,15 @@ void SSE::worm_update()
 
     // Get the next vertex and the new values for next_leg and
     // current_leg_number
-    boost::tie(next_vertex,next_leg)=operator_string[current_vertex].linked_vertices[current_leg+is_upper_leg*2];
+    boost::tie(next_vertex,next_leg)=leg_links[4*current_vertex+current_leg+is_upper_leg*2];
     current_leg_number=next_leg+(1-is_upper_leg)*2;
     //std::cerr << "Following to: " << next_vertex << " " << next_leg << "\n";
           
     // Change states of sites if the worm go accross imaginary time
     // boundary conditions **** Improve this ??? ****
             
-    int s = current_leg ? target(bond(operator_string[current_vertex].bond_number))
-                          : source(bond(operator_string[current_vertex].bond_number));
+    int s = current_leg ? bond_target_table[operator_string[current_vertex].bond_number]
+                          : bond_source_table[operator_string[current_vertex].bond_number];
     
         
     bool crossed=false;
@@ -462,14 +464,15 @@ void SSE::worm_update()
 SSE::state_type SSE::return_exit_leg(alps::uint32_t vertex,state_type incomingleg)
 {
   state_type* MP= operator_string[vertex].leg;
-  boost::multi_array<double, 2>  prob = proba_worm[bond_type[bond(operator_string[vertex].bond_number)]][MP[0]][MP[1]][MP[2]][MP[3]];
+  std::size_t S=maximum_number_of_states;
+  double const* prob = &exit_leg_table[(((((bond_type_table[operator_string[vertex].bond_number]*S+MP[0])*S+MP[1])*S+MP[2])*S+MP[3])*4+incomingleg)*4];
 
   double aa=random_real(); 
-  if (aa<prob[0][incomingleg])
+  if (aa<prob[0])
     return 0;
-  else if (aa<prob[1][incomingleg])
+  else if (aa<prob[1])
     return 1;
-  else if (aa<prob[2][incomingleg])
+  else if (aa<prob[2])
     return 2;
   else
     return 3;
@@ -110,10 +110,24 @@ private :
   std::map<int,boost::multi_array<double,4> > matrix_element;
   boost::multi_array<double, 3> proba_diagonal;
   boost::multi_array<double, 7> proba_worm;
+
+  // flat copies of proba_diagonal and proba_worm for the update loops,
+  // indexed by the bond type and the packed leg states. The four
+  // cumulative exit probabilities for one vertex and incoming leg are
+  // stored next to each other.
+  std::vector<double> diagonal_table;
+  std::vector<double> exit_leg_table;
+  std::vector<alps::uint32_t> bond_type_table;
+  std::vector<alps::uint32_t> bond_source_table;
+  std::vector<alps::uint32_t> bond_target_table;
  
   vector<double> energy_offset;
   vector<vertex_type> operator_string;
   vector<vertex_type> operator_string_copy;
+  // The vertices linked to the legs of each vertex, the four legs of vertex
+  // i being at 4*i ... 4*i+3. uint32_t is the vertex number in the operator
+  // string, bool specifies whether it is target's left or right leg
+  vector<std::pair<alps::uint32_t, bool> > leg_links;
   std::vector<alps::uint32_t> op_indices;
   alps::uint32_t current_number_of_non_identity;
   std::valarray<double> green;
@@ -142,6 +156,7 @@ private :
   void print_arrays();
   void determine_bonds_offset();
   void initialize_diagonal_update_probabilities();
+  void initialize_update_tables();
   void initialize_simulation();
 
   /******** SSE.Update.cpp ********/
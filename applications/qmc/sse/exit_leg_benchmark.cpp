@@ -0,0 +1,118 @@
+/*****************************************************************************
+*
+* ALPS Project Applications
+*
+* Copyright (C) 2001-2013 by Fabien Alet <alet@comp-phys.org>,
+*                            Matthias Troyer <troyer@comp-phys.org>
+*
+* This software is part of the ALPS Applications, published under the ALPS
+* Application License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+* 
+* You should have received a copy of the ALPS Application License along with
+* the ALPS Applications; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT 
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE 
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE, 
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+/* $Id$ */
+
+// Compares the choice of the exit leg of the worm from the nested
+// probability array (a copy of the 4x4 sub-array per vertex, as the worm
+// update did before) with the flat table used now. The tables are filled
+// with random cumulative probabilities for a number of bond types and
+// site states, and both lookups are checked to give the same exit legs.
+//
+// usage: dirloop_sse_exit_leg_benchmark [number of states] [number of steps]
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/multi_array.hpp>
+#include <boost/random.hpp>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+double elapsed(boost::posix_time::ptime start)
+{
+  return (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() * 1e-6;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t S = argc > 1 ? boost::lexical_cast<std::size_t>(argv[1]) : 3;
+  std::size_t steps = argc > 2 ? boost::lexical_cast<std::size_t>(argv[2]) : 10000000;
+  std::size_t T = 2; // number of bond types
+
+  boost::mt19937 eng;
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<> > random_real(eng, boost::uniform_real<>());
+
+  boost::multi_array<double, 7> proba_worm(boost::extents[T][S][S][S][S][4][4]);
+  std::vector<double> exit_leg_table(T*S*S*S*S*16);
+  for (std::size_t i=0;i<T;++i)
+    for (std::size_t l0=0;l0<S;++l0)
+      for (std::size_t l1=0;l1<S;++l1)
+        for (std::size_t l2=0;l2<S;++l2)
+          for (std::size_t l3=0;l3<S;++l3)
+            for (std::size_t inc=0;inc<4;++inc) {
+              double p[3] = { random_real(), random_real(), random_real() };
+              std::sort(p, p+3);
+              for (std::size_t out=0;out<4;++out) {
+                double c = out < 3 ? p[out] : 1.;
+                proba_worm[i][l0][l1][l2][l3][out][inc] = c;
+                exit_leg_table[(((((i*S+l0)*S+l1)*S+l2)*S+l3)*4+inc)*4+out] = c;
+              }
+            }
+
+  // random vertices visited by the worm (bond type, four leg states and
+  // incoming leg), and the random numbers used there
+  std::size_t const n = 1 << 16;
+  std::vector<unsigned char> vertices(6*n);
+  std::vector<double> aa(n);
+  for (std::size_t k=0;k<n;++k) {
+    vertices[6*k] = static_cast<unsigned char>(T * random_real());
+    for (int j=1;j<5;++j)
+      vertices[6*k+j] = static_cast<unsigned char>(S * random_real());
+    vertices[6*k+5] = static_cast<unsigned char>(4 * random_real());
+    aa[k] = random_real();
+  }
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  std::size_t sum_nested = 0;
+  for (std::size_t step=0;step<steps;++step) {
+    unsigned char const* v = &vertices[6*(step%n)];
+    boost::multi_array<double, 2> prob = proba_worm[v[0]][v[1]][v[2]][v[3]][v[4]];
+    double a = aa[step%n];
+    sum_nested += (a<prob[0][v[5]]) ? 0 : (a<prob[1][v[5]]) ? 1 : (a<prob[2][v[5]]) ? 2 : 3;
+  }
+  double t_nested = elapsed(start);
+
+  start = boost::posix_time::microsec_clock::local_time();
+  std::size_t sum_flat = 0;
+  for (std::size_t step=0;step<steps;++step) {
+    unsigned char const* v = &vertices[6*(step%n)];
+    double const* prob = &exit_leg_table[(((((v[0]*S+v[1])*S+v[2])*S+v[3])*S+v[4])*4+v[5])*4];
+    double a = aa[step%n];
+    sum_flat += (a<prob[0]) ? 0 : (a<prob[1]) ? 1 : (a<prob[2]) ? 2 : 3;
+  }
+  double t_flat = elapsed(start);
+
+  std::cout << "number of states = " << S << ", steps = " << steps << "\n";
+  std::cout << "nested array: " << steps / t_nested * 1e-6 << " M steps/s\n";
+  std::cout << "flat table:   " << steps / t_flat * 1e-6 << " M steps/s\n";
+  std::cout << "speedup: " << t_nested / t_flat << "\n";
+  if (sum_nested != sum_flat) {
+    std::cerr << "exit legs differ: " << sum_nested << " " << sum_flat << "\n";
+    return -1;
+  }
+  return 0;
+}
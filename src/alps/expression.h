@@ -34,3 +34,4 @@
 #include <alps/expression/expression.h>
 #include <alps/expression/parameterevaluator.h>
 #include <alps/expression/evaluate.h>
+#include <alps/expression/compiled.h>
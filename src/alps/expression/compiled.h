@@ -0,0 +1,358 @@
+/*****************************************************************************
+*
+* ALPS Project: Algorithms and Libraries for Physics Simulations
+*
+* ALPS Libraries
+*
+* Copyright (C) 2001-2005 by Matthias Troyer <troyer@comp-phys.org>,
+*                            Synge Todo <wistaria@comp-phys.org>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+* 
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT 
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE 
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE, 
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+/* $Id$ */
+
+#ifndef ALPS_EXPRESSION_COMPILED_H
+#define ALPS_EXPRESSION_COMPILED_H
+
+#include <alps/expression/expression_fwd.h>
+#include <alps/expression/expression.h>
+#include <alps/expression/evaluator.h>
+#include <alps/expression/block.h>
+#include <alps/expression/function.h>
+#include <alps/expression/number.h>
+#include <alps/expression/symbol.h>
+#include <alps/numeric/is_nonzero.hpp>
+
+namespace alps {
+namespace expression {
+
+//
+// CompiledExpression<T>
+//
+// An expression lowered to a flat list of instructions for a small stack
+// machine. The expression is first partially evaluated with the given
+// evaluator, usually a ParameterEvaluator with the parameters shared by all
+// bonds or sites. Each symbol left after that gets a slot, numbered in the
+// order of first appearance, and value() reads the symbol values from an
+// array indexed by slot. Evaluation thus needs neither string lookups nor
+// virtual calls.
+//
+// Products are evaluated from left to right and stop at the first zero
+// factor, and random numbers are drawn in the same order, as in
+// Expression<T>::value(). Functions other than those known to Evaluator<T>
+// cannot be compiled, and the constructor throws std::runtime_error for them.
+//
+
+template<class T>
+class CompiledExpression {
+public:
+  typedef T value_type;
+
+  CompiledExpression() : max_stack_(0) {}
+  CompiledExpression(const Expression<T>& e, const Evaluator<T>& eval = Evaluator<T>(false));
+
+  const std::vector<std::string>& slots() const { return slots_; }
+  // the slot of a symbol, or -1 if the expression does not depend on it
+  int slot(const std::string& name) const;
+
+  value_type value(const value_type* slot_values) const;
+  value_type value(const std::vector<value_type>& slot_values) const
+  { return value(slot_values.empty() ? 0 : &slot_values[0]); }
+
+private:
+  enum opcode {
+    op_constant,      // push constants_[arg]
+    op_slot,          // push slot arg
+    op_add,
+    op_multiply,
+    op_negate,        // negate unless zero, as Term<T>
+    op_inverse,
+    op_power,         // real power of the real part, as Factor<T>
+    op_function,      // apply the function arg to the arguments on the stack
+    op_skip_if_zero   // jump to instruction arg if the top of the stack is zero
+  };
+
+  enum function_code {
+    f_sqrt, f_abs, f_sin, f_cos, f_tan, f_asin, f_acos, f_atan, f_exp, f_log,
+    f_atan2, f_integer_random, f_random, f_gaussian_random, f_gaussian_random2
+  };
+
+  struct instruction {
+    instruction(opcode o, unsigned int a = 0) : op(o), arg(a) {}
+    opcode op;
+    unsigned int arg;
+  };
+
+  void emit(opcode op, unsigned int arg, int stack_change);
+  void compile(const Expression<T>& e);
+  void compile(const Term<T>& t);
+  void compile(const Factor<T>& f);
+  void compile(const Evaluatable<T>& e);
+  void compile_function(const Function<T>& f);
+
+  std::vector<instruction> code_;
+  std::vector<value_type> constants_;
+  std::vector<std::string> slots_;
+  unsigned int stack_;
+  unsigned int max_stack_;
+};
+
+//
+// implementation of CompiledExpression<T>
+//
+
+template<class T>
+CompiledExpression<T>::CompiledExpression(const Expression<T>& e, const Evaluator<T>& eval)
+  : stack_(0), max_stack_(0)
+{
+  Expression<T> ex(e);
+  ex.partial_evaluate(eval);
+  compile(ex);
+}
+
+template<class T>
+int CompiledExpression<T>::slot(const std::string& name) const
+{
+  std::vector<std::string>::const_iterator it = std::find(slots_.begin(), slots_.end(), name);
+  return it == slots_.end() ? -1 : int(it - slots_.begin());
+}
+
+template<class T>
+void CompiledExpression<T>::emit(opcode op, unsigned int arg, int stack_change)
+{
+  code_.push_back(instruction(op, arg));
+  stack_ += stack_change;
+  max_stack_ = std::max(max_stack_, stack_);
+}
+
+template<class T>
+void CompiledExpression<T>::compile(const Expression<T>& e)
+{
+  typename Expression<T>::term_iterator it = e.terms().first;
+  if (it == e.terms().second) {
+    constants_.push_back(value_type(0.));
+    emit(op_constant, constants_.size()-1, 1);
+    return;
+  }
+  compile(*it);
+  for (++it; it != e.terms().second; ++it) {
+    compile(*it);
+    emit(op_add, 0, -1);
+  }
+}
+
+template<class T>
+void CompiledExpression<T>::compile(const Term<T>& t)
+{
+  typename Term<T>::factor_iterator it = t.factors().first;
+  if (it == t.factors().second) {
+    constants_.push_back(value_type(1.));
+    emit(op_constant, constants_.size()-1, 1);
+  }
+  else {
+    compile(*it);
+    std::vector<std::size_t> skips;
+    for (++it; it != t.factors().second; ++it) {
+      skips.push_back(code_.size());
+      emit(op_skip_if_zero, 0, 0);
+      compile(*it);
+      emit(op_multiply, 0, -1);
+    }
+    for (std::size_t i = 0; i < skips.size(); ++i)
+      code_[skips[i]].arg = code_.size();
+  }
+  if (t.is_negative())
+    emit(op_negate, 0, 0);
+}
+
+template<class T>
+void CompiledExpression<T>::compile(const Factor<T>& f)
+{
+  if (!f.evaluatable())
+    boost::throw_exception(std::runtime_error("Empty value in expression"));
+  compile(*f.evaluatable());
+  if (f.is_inverse())
+    emit(op_inverse, 0, 0);
+  if (!f.unit_power()) {
+    if (!f.power().evaluatable())
+      boost::throw_exception(std::runtime_error("Empty value in expression"));
+    compile(*f.power().evaluatable());
+    emit(op_power, 0, -1);
+  }
+}
+
+template<class T>
+void CompiledExpression<T>::compile(const Evaluatable<T>& e)
+{
+  if (const Factor<T>* f = dynamic_cast<const Factor<T>*>(&e))
+    compile(*f);
+  else if (const SimpleFactor<T>* f = dynamic_cast<const SimpleFactor<T>*>(&e)) {
+    if (!f->evaluatable())
+      boost::throw_exception(std::runtime_error("Empty value in expression"));
+    compile(*f->evaluatable());
+  }
+  else if (const Expression<T>* x = dynamic_cast<const Expression<T>*>(&e))
+    compile(*x);
+  else if (const Term<T>* t = dynamic_cast<const Term<T>*>(&e))
+    compile(*t);
+  else if (const Number<T>* n = dynamic_cast<const Number<T>*>(&e)) {
+    constants_.push_back(n->value());
+    emit(op_constant, constants_.size()-1, 1);
+  }
+  else if (const Symbol<T>* s = dynamic_cast<const Symbol<T>*>(&e)) {
+    int i = slot(s->name());
+    if (i < 0) {
+      i = slots_.size();
+      slots_.push_back(s->name());
+    }
+    emit(op_slot, i, 1);
+  }
+  else if (const Function<T>* f = dynamic_cast<const Function<T>*>(&e))
+    compile_function(*f);
+  else
+    boost::throw_exception(std::runtime_error("Cannot compile expression " + boost::lexical_cast<std::string>(e)));
+}
+
+template<class T>
+void CompiledExpression<T>::compile_function(const Function<T>& f)
+{
+  const std::string& name = f.name();
+  const std::vector<Expression<T> >& args = f.arguments();
+  function_code code;
+  if (args.size() == 0 && name == "random")
+    code = f_random;
+  else if (args.size() == 0 && (name == "gaussian_random" || name == "normal_random"))
+    code = f_gaussian_random;
+  else if (args.size() == 1 && name == "sqrt")
+    code = f_sqrt;
+  else if (args.size() == 1 && name == "abs")
+    code = f_abs;
+  else if (args.size() == 1 && name == "sin")
+    code = f_sin;
+  else if (args.size() == 1 && name == "cos")
+    code = f_cos;
+  else if (args.size() == 1 && name == "tan")
+    code = f_tan;
+  else if (args.size() == 1 && name == "asin")
+    code = f_asin;
+  else if (args.size() == 1 && name == "acos")
+    code = f_acos;
+  else if (args.size() == 1 && name == "atan")
+    code = f_atan;
+  else if (args.size() == 1 && name == "exp")
+    code = f_exp;
+  else if (args.size() == 1 && name == "log")
+    code = f_log;
+  else if (args.size() == 1 && name == "integer_random")
+    code = f_integer_random;
+  else if (args.size() == 2 && name == "atan2")
+    code = f_atan2;
+  else if (args.size() == 2 && (name == "gaussian_random" || name == "normal_random"))
+    code = f_gaussian_random2;
+  else
+    boost::throw_exception(std::runtime_error("Cannot compile function " + name));
+  for (std::size_t i = 0; i < args.size(); ++i)
+    compile(args[i]);
+  emit(op_function, code, 1 - int(args.size()));
+}
+
+template<class T>
+typename CompiledExpression<T>::value_type CompiledExpression<T>::value(const value_type* slot_values) const
+{
+  value_type local[16];
+  std::vector<value_type> heap;
+  value_type* stack = local;
+  if (max_stack_ > 16) {
+    heap.resize(max_stack_);
+    stack = &heap[0];
+  }
+  value_type* top = stack - 1;  // the topmost element on the stack
+  for (std::size_t pc = 0; pc < code_.size(); ++pc) {
+    const instruction& in = code_[pc];
+    switch (in.op) {
+    case op_constant:
+      *++top = constants_[in.arg];
+      break;
+    case op_slot:
+      *++top = slot_values[in.arg];
+      break;
+    case op_add:
+      --top;
+      top[0] += top[1];
+      break;
+    case op_multiply:
+      --top;
+      top[0] *= top[1];
+      break;
+    case op_negate:
+      if (numeric::is_nonzero(*top))
+        *top = *top * (-1.);
+      break;
+    case op_inverse:
+      *top = 1. / *top;
+      break;
+    case op_power:
+      --top;
+      top[0] = std::pow(evaluate_helper<T>::real(top[0]), evaluate_helper<T>::real(top[1]));
+      break;
+    case op_skip_if_zero:
+      if (!numeric::is_nonzero(*top))
+        pc = in.arg - 1;
+      break;
+    case op_function:
+      switch (in.arg) {
+      case f_sqrt: *top = std::sqrt(*top); break;
+      case f_abs: *top = std::abs(*top); break;
+      case f_sin: *top = std::sin(*top); break;
+      case f_cos: *top = std::cos(*top); break;
+      case f_tan: *top = std::tan(*top); break;
+      case f_asin: *top = std::asin(evaluate_helper<T>::real(*top)); break;
+      case f_acos: *top = std::acos(evaluate_helper<T>::real(*top)); break;
+      case f_atan: *top = std::atan(evaluate_helper<T>::real(*top)); break;
+      case f_exp: *top = std::exp(*top); break;
+      case f_log: *top = std::log(*top); break;
+      case f_integer_random:
+        *top = static_cast<int>(evaluate_helper<T>::real(*top)*Disorder::random());
+        break;
+      case f_random:
+        *++top = Disorder::random();
+        break;
+      case f_gaussian_random:
+        *++top = Disorder::gaussian_random();
+        break;
+      case f_atan2:
+        --top;
+        top[0] = static_cast<T>(std::atan2(evaluate_helper<T>::real(top[0]), evaluate_helper<T>::real(top[1])));
+        break;
+      case f_gaussian_random2:
+        --top;
+        top[0] = evaluate_helper<T>::real(top[0]) + evaluate_helper<T>::real(top[1])*Disorder::gaussian_random();
+        break;
+      }
+      break;
+    }
+  }
+  return *top;
+}
+
+} // end namespace expression
+} // end namespace alps
+
+#endif // ! ALPS_EXPRESSION_COMPILED_H
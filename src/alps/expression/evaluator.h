@@ -41,14 +41,32 @@ class ALPS_DECL Disorder
 {
 public:
   typedef boost::mt19937 random_type;
+
+  /// \brief gives the calling thread its own disorder generator
+  ///
+  /// While an object of this class exists, the thread that created it draws
+  /// from and seeds its own generator, which starts in the default state.
+  /// All other threads keep sharing the global generator.
+  class ALPS_DECL thread_generator
+  {
+  public:
+    thread_generator();
+    ~thread_generator();
+  private:
+    thread_generator(const thread_generator&);
+    thread_generator& operator=(const thread_generator&);
+  };
+
+  static double random();
+  static double gaussian_random();
+  static void seed(unsigned int =0);
+  static void seed_if_unseeded(const alps::Parameters&);
+
 private:
+  static random_type& generator();
+  static int& last_seed();
   static random_type rng_;
   static int last_seed_;
-public:
-  static boost::variate_generator<random_type&,boost::uniform_real<> > random;
-  static boost::variate_generator<random_type&,boost::normal_distribution<> > gaussian_random;
-  static void seed(unsigned int =0);
-  static void seed_if_unseeded(const alps::Parameters&);
 };
 
 namespace expression {
@@ -76,6 +76,7 @@ public:
   {
     return term_ ? term_->depends_on(s) : false;
   }
+  const Evaluatable<T>* evaluatable() const { return term_.get(); }
 
 protected:
   boost::shared_ptr<Evaluatable<T> > term_;
@@ -109,6 +110,7 @@ public:
   }
   bool unit_power() const { return power_.can_evaluate() && power_.value() ==1.;}
   bool is_single_term() const { return super_type::is_single_term() && unit_power(); }
+  const SimpleFactor<T>& power() const { return power_; }
 
 private:
   bool is_inverse_;
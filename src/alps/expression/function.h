@@ -52,6 +52,8 @@ public:
   boost::shared_ptr<Evaluatable<T> > flatten_one();
   Evaluatable<T>* partial_evaluate_replace(const Evaluator<T>& =Evaluator<T>(), bool=false);
   bool depends_on(const std::string& s) const;
+  const std::string& name() const { return name_; }
+  const std::vector<Expression<T> >& arguments() const { return args_; }
 private:
  std::string name_;
  std::vector<Expression<T> > args_;
@@ -50,6 +50,7 @@ public:
   Evaluatable<T>* clone() const { return new Symbol<T>(*this); }
   Evaluatable<T>* partial_evaluate_replace(const Evaluator<T>& =Evaluator<T>(), bool=false);
   bool depends_on(const std::string& s) const;
+  const std::string& name() const { return name_; }
 private:
   std::string name_;
 };
@@ -69,6 +69,39 @@ namespace alps {
                 return num_bits_required_for(num_vertices(g));
             }
 
+            inline unsigned int lowest_set_bit(boost::uint64_t mask)
+            {
+                assert(mask != 0);
+#if defined(__GNUC__)
+                return __builtin_ctzll(mask);
+#else
+                unsigned int bit = 0;
+                while (!(mask & 0x01))
+                {
+                    mask >>= 1;
+                    ++bit;
+                }
+                return bit;
+#endif
+            }
+
+            // Adjacency matrix of a subgraph as one bitmask per vertex:
+            // bit t of mask[s] is set if s and t are adjacent.
+            // Empty for subgraphs with more than 64 vertices, the walker then uses the adjacency lists of the subgraph.
+            template <typename Subgraph>
+            std::vector<boost::uint64_t> build_adjacency_masks(Subgraph const& S)
+            {
+                if (num_vertices(S) > 64)
+                    return std::vector<boost::uint64_t>();
+                std::vector<boost::uint64_t> mask(num_vertices(S), 0);
+                typename boost::graph_traits<Subgraph>::edge_iterator ei, ee;
+                for (boost::tie(ei, ee) = edges(S); ei != ee; ++ei) {
+                    mask[source(*ei, S)] |= boost::uint64_t(0x01) << target(*ei, S);
+                    mask[target(*ei, S)] |= boost::uint64_t(0x01) << source(*ei, S);
+                }
+                return mask;
+            }
+
             template <typename VertexDataType>
             class embeddings_set
             {
@@ -85,6 +118,8 @@ namespace alps {
                     }
                     bool operator()(std::size_t i, std::size_t j) const
                     {
+                        if(parent_.hashes_[i] != parent_.hashes_[j])
+                            return false;
                         assert( (i+1) * parent_.edges_entry_size_    <= distance(parent_.edges_data_.begin(), parent_.edges_data_.end()) );
                         assert( (j+1) * parent_.edges_entry_size_    <= distance(parent_.edges_data_.begin(), parent_.edges_data_.end()) );
                         assert( (i+1) * parent_.vertices_entry_size_ <= distance(parent_.vertices_data_.begin(), parent_.vertices_data_.end()) );
@@ -111,25 +146,8 @@ namespace alps {
                     }
                     std::size_t operator()(std::size_t i) const
                     {
-                        assert( (i+1) * parent_.edges_entry_size_     <= distance(parent_.edges_data_.begin(), parent_.edges_data_.end()) );
-                        assert( (i+1) * parent_.vertices_entry_size_  <= distance(parent_.vertices_data_.begin(), parent_.vertices_data_.end()) );
-                        using boost::hash_combine;
-                        std::size_t hash = 0;
-                        typename std::vector<VertexDataType>::const_iterator vit (parent_.vertices_data_.begin() + i*parent_.vertices_entry_size_);
-                        typename std::vector<VertexDataType>::const_iterator vend(vit + parent_.vertices_entry_size_);
-                        while( vit != vend)
-                        {
-                            hash_combine(hash, *vit);
-                            ++vit;
-                        }
-                        std::vector<boost::uint64_t>::const_iterator eit (parent_.edges_data_.begin() + i*parent_.edges_entry_size_);
-                        std::vector<boost::uint64_t>::const_iterator eend(eit + parent_.edges_entry_size_);
-                        while( eit != eend)
-                        {
-                            hash_combine(hash, *eit);
-                            ++eit;
-                        }
-                        return hash;
+                        assert( i < parent_.hashes_.size() );
+                        return parent_.hashes_[i];
                     }
                   private:
                     embeddings_set const& parent_;
@@ -156,10 +174,12 @@ namespace alps {
                     std::size_t const num_entries = set_.size();
                     assert( vertices_data_.size() / vertices_entry_size_ == num_entries + 1);
                     assert( edges_data_.size() / edges_entry_size_       == num_entries + 1);
+                    hashes_.push_back(hash_entry(&vertices_data_[vsize], &edges_data_[esize]));
                     if(!set_.insert(num_entries).second)
                     {
                         vertices_data_.resize(vsize);
                         edges_data_.resize(esize);
+                        hashes_.pop_back();
                         return false;
                     }
                     else
@@ -172,6 +192,19 @@ namespace alps {
                 }
 
               private:
+                // The hash of each entry is computed once and stored in hashes_,
+                // so that rehashing the set does not have to go through the entry data again.
+                std::size_t hash_entry(VertexDataType const* vertices_entry, boost::uint64_t const* edges_entry) const
+                {
+                    using boost::hash_combine;
+                    std::size_t hash = 0;
+                    for(VertexDataType const* vit = vertices_entry; vit != vertices_entry + vertices_entry_size_; ++vit)
+                        hash_combine(hash, *vit);
+                    for(boost::uint64_t const* eit = edges_entry; eit != edges_entry + edges_entry_size_; ++eit)
+                        hash_combine(hash, *eit);
+                    return hash;
+                }
+
                 template <typename SubGraph>
                 void create_entry(VertexDataType * const vertices_entry, boost::uint64_t * const edges_entry, std::vector< boost::tuple<boost::uint16_t, VertexDataType, unsigned int> > const& embedding_data, SubGraph const& S)
                 {
@@ -198,14 +231,22 @@ namespace alps {
                 }
 
                 template <typename SubGraph>
-                static void create_edge_part(boost::uint64_t * const edges_entry, std::vector<std::size_t> const& index_of_subgraph_vertex, SubGraph const& S)
+                void create_edge_part(boost::uint64_t * const edges_entry, std::vector<std::size_t> const& index_of_subgraph_vertex, SubGraph const& S)
                 {
-                    typename boost::graph_traits<SubGraph>::edge_iterator s_ei, s_ee;
-                    for( boost::tie(s_ei, s_ee) = edges(S); s_ei != s_ee; ++s_ei) {
+                    // The edges of S are the same for all entries, keep them as a flat list
+                    if(edge_list_.empty())
+                    {
+                        typename boost::graph_traits<SubGraph>::edge_iterator s_ei, s_ee;
+                        for( boost::tie(s_ei, s_ee) = edges(S); s_ei != s_ee; ++s_ei) {
+                            edge_list_.push_back(source(*s_ei, S));
+                            edge_list_.push_back(target(*s_ei, S));
+                        }
+                    }
+                    for(std::vector<std::size_t>::const_iterator it = edge_list_.begin(); it != edge_list_.end(); it += 2) {
                         std::size_t v1, v2;
-                        boost::tie(v1,v2) = boost::minmax(index_of_subgraph_vertex[source(*s_ei, S)], index_of_subgraph_vertex[target(*s_ei, S)]);
-                        std::size_t index = v1 * num_vertices(S) - (v1 - 1) * v1 / 2 + v2 - v1;
-                        *(edges_entry + (index >> 6)) |= 0x01 << (index & 0x3F);
+                        boost::tie(v1,v2) = boost::minmax(index_of_subgraph_vertex[*it], index_of_subgraph_vertex[*(it+1)]);
+                        std::size_t index = v1 * vertices_entry_size_ - (v1 - 1) * v1 / 2 + v2 - v1;
+                        *(edges_entry + (index >> 6)) |= boost::uint64_t(0x01) << (index & 0x3F);
                     }
                 }
 
@@ -213,6 +254,8 @@ namespace alps {
                 std::size_t edges_entry_size_;
                 std::vector<VertexDataType>  vertices_data_;
                 std::vector<boost::uint64_t> edges_data_;
+                std::vector<std::size_t>     hashes_;
+                std::vector<std::size_t>     edge_list_;
                 boost::unordered_set<std::size_t, embeddings_set_entry_hash, embeddings_set_entry_equal> set_;
                 std::vector<std::size_t> index_of_subgraph_vertex_in_embedding_generic_buffer_;
             };
@@ -264,6 +307,18 @@ namespace alps {
                 return distance_to_boarder;
             }
 
+            // Reorders the table of build_distance_table vertex by vertex, such that the distances of one vertex are adjacent:
+            // distance of vertex v along dimension d: distance[v * dimension + d]
+            inline std::vector<boost::uint_t<8>::fast> flatten_distance_table(std::vector<std::vector<boost::uint_t<8>::fast> > const& distance_to_boarder)
+            {
+                std::size_t const dim = distance_to_boarder.size();
+                std::vector<boost::uint_t<8>::fast> distance(dim == 0 ? 0 : dim * distance_to_boarder[0].size());
+                for(std::size_t d = 0; d < dim; ++d)
+                    for(std::size_t v = 0; v < distance_to_boarder[d].size(); ++v)
+                        distance[v * dim + d] = distance_to_boarder[d][v];
+                return distance;
+            }
+
 
             template <typename SubGraph>
             class count_translational_invariant_embeddings
@@ -274,13 +329,14 @@ namespace alps {
                 template <typename Graph, typename Lattice>
                 count_translational_invariant_embeddings(subgraph_type const& S, Graph const& G, Lattice const& L, typename partition_type<subgraph_type>::type const & subgraph_orbit)
                 : orbit_of_( build_vertex_to_partition_index_map(subgraph_orbit,S) )
-                , distance_to_boarder_( build_distance_table(G,L) )
+                , dimension_( dimension(L) )
+                , distance_to_boarder_( flatten_distance_table(build_distance_table(G,L)) )
                 , matches_( num_vertices(S))
                 , unit_cell_size_( num_vertices(alps::graph::graph(unit_cell(L))) )
                 {
                     assert(( get<alps::graph::partition>(canonical_properties(S)) == subgraph_orbit ));
                     assert(( assert_helpers::partition_has_valid_structure(subgraph_orbit, S) ));
-                    if( !( (0x01ull << (distance_to_boarder_.size() * num_label_bits(S) + num_bits_required_for(unit_cell_size_))) < static_cast<unsigned long long>(boost::integer_traits<boost::uint16_t>::const_max) ) )
+                    if( !( (0x01ull << (dimension_ * num_label_bits(S) + num_bits_required_for(unit_cell_size_))) < static_cast<unsigned long long>(boost::integer_traits<boost::uint16_t>::const_max) ) )
                         throw std::runtime_error("Subgraph, lattice dimension or unit cell is too large. uint16_t is not large enough to store full embedding data.");
                 }
 
@@ -299,6 +355,9 @@ namespace alps {
                     // This is the same number of bits as we need for a unique vertex label of the subgraph
                     unsigned int const bits_per_dim = num_label_bits(S);
 
+                    // The distances are taken relative to the vertex of the embedding closest to the boarder
+                    get_distance_to_boarder(distance_buffer_, pinning, G);
+
                     // Consider translational invariance and get a unique embedding representative
                     // embedding_compressed contains the full embedding information for a subgraph vertex (i.e. index within unit cell, "canonical" position in all dimensions)
                     for (typename std::vector<typename boost::graph_traits<Graph>::vertex_descriptor>::const_iterator it = pinning.begin(); it != pinning.end(); ++it) {
@@ -322,13 +381,12 @@ namespace alps {
                 template <typename Graph>
                 void get_distance_to_boarder(std::vector<boost::uint_t<8>::fast> & distance, std::vector<typename boost::graph_traits<Graph>::vertex_descriptor> const& pinning, Graph const& G) const
                 {
-                    distance.resize(distance_to_boarder_.size(), std::numeric_limits<boost::uint_t<8>::fast>::max());
-                    for(std::size_t d = 0; d < distance_to_boarder_.size(); ++d)
+                    distance.assign(dimension_, std::numeric_limits<boost::uint_t<8>::fast>::max());
+                    for (typename std::vector<typename boost::graph_traits<Graph>::vertex_descriptor>::const_iterator it = pinning.begin(); it != pinning.end(); ++it)
                     {
-                        boost::uint_t<8>::fast dist = std::numeric_limits<boost::uint_t<8>::fast>::max();
-                        for (typename std::vector<typename boost::graph_traits<Graph>::vertex_descriptor>::const_iterator it = pinning.begin(); it != pinning.end(); ++it)
-                            dist = (std::min)(dist, distance_to_boarder_[d][*it]);
-                        distance[d] = dist;
+                        boost::uint_t<8>::fast const* row = &distance_to_boarder_[*it * dimension_];
+                        for(std::size_t d = 0; d < dimension_; ++d)
+                            distance[d] = (std::min)(distance[d], row[d]);
                     }
                 }
 
@@ -339,15 +397,16 @@ namespace alps {
                     , std::vector<typename boost::graph_traits<Graph>::vertex_descriptor> const& pinning
                     , Graph const& G
                 ) const {
-                    assert((0x01u << (distance_to_boarder_.size() * bits_per_dim + num_bits_required_for(unit_cell_size_))) < boost::integer_traits<boost::uint16_t>::const_max && "boost::uint16_t is not large enough to store full embedding data.");
-                    get_distance_to_boarder(distance_buffer_, pinning, G);
+                    assert((0x01u << (dimension_ * bits_per_dim + num_bits_required_for(unit_cell_size_))) < boost::integer_traits<boost::uint16_t>::const_max && "boost::uint16_t is not large enough to store full embedding data.");
+                    assert(distance_buffer_.size() == dimension_);
                     // data =  bitfield looking like: unit_cell_vtx_idx|d[0]|d[1]|...
                     boost::uint16_t data = v_id % unit_cell_size_;
-                    for(std::size_t d = 0; d < distance_to_boarder_.size(); ++d)
+                    boost::uint_t<8>::fast const* row = &distance_to_boarder_[v_id * dimension_];
+                    for(std::size_t d = 0; d < dimension_; ++d)
                     {
                         data <<= bits_per_dim;
-                        assert( distance_to_boarder_[d][v_id] >= distance_buffer_[d] );
-                        boost::uint_t<8>::fast const dist = distance_to_boarder_[d][v_id] - distance_buffer_[d];
+                        assert( row[d] >= distance_buffer_[d] );
+                        boost::uint_t<8>::fast const dist = row[d] - distance_buffer_[d];
                         assert( dist < (0x01u << bits_per_dim) );
                         data += dist;
                     }
@@ -355,7 +414,8 @@ namespace alps {
                 }
 
                 std::vector<std::size_t>                                        orbit_of_;
-                std::vector<std::vector<boost::uint_t<8>::fast> > const         distance_to_boarder_;
+                std::size_t const                                               dimension_;
+                std::vector<boost::uint_t<8>::fast> const                       distance_to_boarder_; // distance of vertex v along dimension d: [v * dimension_ + d]
                 std::vector< boost::tuple<boost::uint16_t, boost::uint16_t, unsigned int> > embedding_data_buffer_;
                 embeddings_set<boost::uint16_t>                                 matches_;
                 mutable std::vector<boost::uint_t<8>::fast>                     distance_buffer_;
@@ -583,6 +643,8 @@ namespace alps {
                 , boost::dynamic_bitset<> & visited
                 , unsigned int visited_cnt
                 , std::vector<typename boost::graph_traits<Graph>::vertex_descriptor> & pinning
+                , std::vector<boost::uint64_t> const & adjacency
+                , boost::uint64_t pinned
                 , VertexEqual & vertex_equal
                 , EdgeEqual & edge_equal
                 , EmbeddingFoundPolicy& register_embedding
@@ -596,19 +658,33 @@ namespace alps {
                 // ... the vertex types are equal (with respect to symmetries maybe)
                 if (!vertex_equal(s, g, S, G))
                     return;
-                // ... the existing edges from s are compatible with those of g.
+                // ... the existing edges from s to already pinned vertices are compatible with those of g.
+                bool const use_masks = !adjacency.empty();
                 typename boost::graph_traits<Subgraph>::adjacency_iterator s_ai, s_ae;
-                for (boost::tie(s_ai, s_ae) = adjacent_vertices(s, S); s_ai != s_ae; ++s_ai)
-                    if (pinning[*s_ai] != num_vertices(G)) {
+                if (use_masks) {
+                    for (boost::uint64_t m = adjacency[s] & pinned; m != 0; m &= m - 1) {
+                        subgraph_vertex_descriptor const t = lowest_set_bit(m);
+                        assert(pinning[t] != num_vertices(G));
                         typename boost::graph_traits<Graph>::edge_descriptor e;
                         bool is_e;
-                        boost::tie(e, is_e) = edge(g, pinning[*s_ai], G);
-                        if (!is_e || !edge_equal( edge(s, *s_ai, S).first , e, S, G) )
+                        boost::tie(e, is_e) = edge(g, pinning[t], G);
+                        if (!is_e || !edge_equal( edge(s, t, S).first , e, S, G) )
                             return;
                     }
+                } else
+                    for (boost::tie(s_ai, s_ae) = adjacent_vertices(s, S); s_ai != s_ae; ++s_ai)
+                        if (pinning[*s_ai] != num_vertices(G)) {
+                            typename boost::graph_traits<Graph>::edge_descriptor e;
+                            bool is_e;
+                            boost::tie(e, is_e) = edge(g, pinning[*s_ai], G);
+                            if (!is_e || !edge_equal( edge(s, *s_ai, S).first , e, S, G) )
+                                return;
+                        }
 
                 // s->g seems legit => pin s->g.
                 pinning[s] = g;
+                if (use_masks)
+                    pinned |= boost::uint64_t(0x01) << s;
                 visited.set(g);
                 ++visited_cnt;
                 assert(visited_cnt == visited.count()); // visited.count is called frequently and is rather slow -> cached
@@ -621,10 +697,16 @@ namespace alps {
                     > local_queue(queue);
 
                     typename boost::graph_traits<Graph>::adjacency_iterator g_ai, g_ae;
-                    for (boost::tie(s_ai, s_ae) = adjacent_vertices(s, S); s_ai != s_ae; ++s_ai)
-                        if ( !local_queue.was_queued(*s_ai) ) {
-                            local_queue.push_back(std::make_pair(*s_ai, g));
+                    if (use_masks)
+                        for (boost::uint64_t m = adjacency[s]; m != 0; m &= m - 1) {
+                            subgraph_vertex_descriptor const t = lowest_set_bit(m);
+                            if ( !local_queue.was_queued(t) )
+                                local_queue.push_back(std::make_pair(t, g));
                         }
+                    else
+                        for (boost::tie(s_ai, s_ae) = adjacent_vertices(s, S); s_ai != s_ae; ++s_ai)
+                            if ( !local_queue.was_queued(*s_ai) )
+                                local_queue.push_back(std::make_pair(*s_ai, g));
                     // take the first entry of the queue
                     // and check if entry.s can be mapped to adjacent vertices of entry.g
                     subgraph_vertex_descriptor t = local_queue.front().first;
@@ -641,6 +723,8 @@ namespace alps {
                                 , visited
                                 , visited_cnt
                                 , pinning
+                                , adjacency
+                                , pinned
                                 , vertex_equal
                                 , edge_equal
                                 , register_embedding
@@ -675,6 +759,7 @@ namespace alps {
                 // make sure, that a distance in one direction fits in a boost::uint8_t
                 assert(std::size_t(num_vertices(G)) < 256 * 256);
 
+                std::vector<boost::uint64_t> const adjacency(build_adjacency_masks(S));
                 boost::dynamic_bitset<> visited; // (num_vertices(G));
                 shared_queue_data<
                       typename boost::graph_traits<Subgraph>::vertex_descriptor
@@ -706,6 +791,8 @@ namespace alps {
                                 , visited
                                 , 0
                                 , pinning
+                                , adjacency
+                                , 0
                                 , vertex_equal
                                 , edge_equal
                                 , embedding_found_policy
@@ -739,6 +826,7 @@ namespace alps {
                 // make sure, that a distance in one direction fits in a boost::uint8_t
                 assert(std::size_t(num_vertices(G)) < 256 * 256);
 
+                std::vector<boost::uint64_t> const adjacency(build_adjacency_masks(S));
                 boost::dynamic_bitset<> visited; // (num_vertices(G));
                 shared_queue_data<
                       typename boost::graph_traits<Subgraph>::vertex_descriptor
@@ -767,6 +855,8 @@ namespace alps {
                         , visited
                         , 0
                         , pinning
+                        , adjacency
+                        , 0
                         , vertex_equal
                         , edge_equal
                         , embedding_found_policy
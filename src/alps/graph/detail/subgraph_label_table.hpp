@@ -0,0 +1,168 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                 *
+ * ALPS Project: Algorithms and Libraries for Physics Simulations                  *
+ *                                                                                 *
+ * ALPS Libraries                                                                  *
+ *                                                                                 *
+ * Copyright (C) 2015        by Andreas Hehn <hehn@phys.ethz.ch>                   *
+ *                                                                                 *
+ * This software is part of the ALPS libraries, published under the ALPS           *
+ * Library License; you can use, redistribute it and/or modify it under            *
+ * the terms of the license, either version 1 or (at your option) any later        *
+ * version.                                                                        *
+ *                                                                                 *
+ * You should have received a copy of the ALPS Library License along with          *
+ * the ALPS Libraries; see the file LICENSE.txt. If not, the license is also       *
+ * available from http://alps.comp-phys.org/.                                      *
+ *                                                                                 *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,        *
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT       *
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE       *
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,     *
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER     *
+ * DEALINGS IN THE SOFTWARE.                                                       *
+ *                                                                                 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+#ifndef ALPS_GRAPH_DETAIL_SUBGRAPH_LABEL_TABLE_HPP
+#define ALPS_GRAPH_DETAIL_SUBGRAPH_LABEL_TABLE_HPP
+
+#include <alps/graph/canonical_properties_traits.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+namespace alps {
+namespace graph {
+namespace detail {
+
+/**
+  * subgraph_label_table collects the subgraphs grown from one generation of subgraphs, possibly by several threads at once.
+  * It is split into shards by a hash of the canonical label, each of which is a map from the label to the first subgraph with this label.
+  * Each subgraph is offered with a key (index of the graph it was grown from, index among the graphs grown from it).
+  * The table keeps the subgraph with the smallest key for each label, so that the result is the same as for a serial generator
+  * which keeps the first subgraph found, regardless of the order in which the threads offer their subgraphs.
+  */
+template <typename SubGraph>
+class subgraph_label_table
+{
+  public:
+    typedef std::pair<SubGraph, typename canonical_properties_type<SubGraph>::type> subgraph_properties_pair_type;
+    typedef typename graph_label<SubGraph>::type label_type;
+    typedef std::pair<std::size_t, std::size_t> key_type;
+
+    struct entry
+    {
+        key_type key;
+        subgraph_properties_pair_type graph;
+        bool embeddable;
+    };
+
+    subgraph_label_table()
+        : shards_(num_shards)
+    {
+#ifdef _OPENMP
+        locks_.resize(num_shards);
+        for(std::vector<omp_lock_t>::iterator it = locks_.begin(); it != locks_.end(); ++it)
+            omp_init_lock(&*it);
+#endif
+    }
+
+    ~subgraph_label_table()
+    {
+#ifdef _OPENMP
+        for(std::vector<omp_lock_t>::iterator it = locks_.begin(); it != locks_.end(); ++it)
+            omp_destroy_lock(&*it);
+#endif
+    }
+
+    /**
+      * Offers the subgraph g with the given key.
+      * \return true if the label of g was unknown. The caller then has to check the embedding of g and pass the result to set_embeddable().
+      */
+    bool offer(key_type const& key, subgraph_properties_pair_type const& g)
+    {
+        label_type const& label(boost::get<alps::graph::label>(g.second));
+        std::size_t const s = shard(label);
+        lock(s);
+        typename shard_type::iterator it = shards_[s].find(label);
+        bool const unknown = (it == shards_[s].end());
+        if(unknown)
+        {
+            entry e = { key, g, false };
+            shards_[s].insert(std::make_pair(label, e));
+        }
+        else if(key < it->second.key)
+        {
+            it->second.key = key;
+            it->second.graph = g;
+        }
+        unlock(s);
+        return unknown;
+    }
+
+    void set_embeddable(label_type const& label, bool embeddable)
+    {
+        std::size_t const s = shard(label);
+        lock(s);
+        shards_[s].find(label)->second.embeddable = embeddable;
+        unlock(s);
+    }
+
+    /**
+      * \return the entries sorted by their keys, i.e. in the order in which a serial generator would have found them
+      * (not thread-safe)
+      */
+    std::vector<entry const*> sorted_entries() const
+    {
+        std::vector<entry const*> result;
+        for(typename std::vector<shard_type>::const_iterator s_it = shards_.begin(); s_it != shards_.end(); ++s_it)
+            for(typename shard_type::const_iterator it = s_it->begin(); it != s_it->end(); ++it)
+                result.push_back(&it->second);
+        std::sort(result.begin(), result.end(), key_less());
+        return result;
+    }
+
+  private:
+    typedef std::map<label_type, entry> shard_type;
+    static std::size_t const num_shards = 64;
+
+    struct key_less
+    {
+        bool operator()(entry const* a, entry const* b) const { return a->key < b->key; }
+    };
+
+    // hash of the adjacency matrix of the label
+    static std::size_t shard(label_type const& label)
+    {
+        graph_label_matrix_type const& m(boost::get<0>(label));
+        std::size_t h = m.size();
+        for(std::size_t i = m.find_first(); i != graph_label_matrix_type::npos; i = m.find_next(i))
+            h = 31 * h + i;
+        return h % num_shards;
+    }
+
+#ifdef _OPENMP
+    void lock(std::size_t s)   { omp_set_lock(&locks_[s]); }
+    void unlock(std::size_t s) { omp_unset_lock(&locks_[s]); }
+    std::vector<omp_lock_t> locks_;
+#else
+    void lock(std::size_t)   {}
+    void unlock(std::size_t) {}
+#endif
+    std::vector<shard_type> shards_;
+
+    subgraph_label_table(subgraph_label_table const&);
+    subgraph_label_table& operator = (subgraph_label_table const&);
+};
+
+} // end namespace detail
+} // end namespace graph
+} // end namespace alps
+
+#endif // ALPS_GRAPH_DETAIL_SUBGRAPH_LABEL_TABLE_HPP
@@ -0,0 +1,244 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                 *
+ * ALPS Project: Algorithms and Libraries for Physics Simulations                  *
+ *                                                                                 *
+ * ALPS Libraries                                                                  *
+ *                                                                                 *
+ * Copyright (C) 2010 - 2013 by Lukas Gamper <gamperl@gmail.com>                   *
+ *                              Andreas Hehn <hehn@phys.ethz.ch>                   *
+ *                                                                                 *
+ * This software is part of the ALPS libraries, published under the ALPS           *
+ * Library License; you can use, redistribute it and/or modify it under            *
+ * the terms of the license, either version 1 or (at your option) any later        *
+ * version.                                                                        *
+ *                                                                                 *
+ * You should have received a copy of the ALPS Library License along with          *
+ * the ALPS Libraries; see the file LICENSE.txt. If not, the license is also       *
+ * available from http://alps.comp-phys.org/.                                      *
+ *                                                                                 *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,        *
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT       *
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE       *
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,     *
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER     *
+ * DEALINGS IN THE SOFTWARE.                                                       *
+ *                                                                                 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef ALPS_GRAPH_LATTICE_CONSTANT_CACHE_HPP
+#define ALPS_GRAPH_LATTICE_CONSTANT_CACHE_HPP
+
+#include <alps/graph/lattice_constant.hpp>
+#include <alps/graph/canonical_properties.hpp>
+#include <alps/graph/vertices_of_cell.hpp>
+
+#include <boost/cstdint.hpp>
+#include <boost/tuple/tuple_io.hpp>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace alps {
+    namespace graph {
+
+        namespace detail {
+
+            // 64 bit FNV-1a hash. Values are fed as 64 bit little endian integers, so the hash
+            // written to the cache file does not depend on the platform or the Boost version.
+            class fnv1a_hash {
+                public:
+                    fnv1a_hash() : hash_(0xcbf29ce484222325ull) {}
+                    void operator()(boost::uint64_t value) {
+                        for (unsigned int i = 0; i < 8; ++i) {
+                            hash_ ^= (value >> (8 * i)) & 0xff;
+                            hash_ *= 0x100000001b3ull;
+                        }
+                    }
+                    boost::uint64_t value() const { return hash_; }
+                private:
+                    boost::uint64_t hash_;
+            };
+
+            // Topology of the lattice graph: number of vertices and the edges in their order in the graph.
+            template<typename Graph> boost::uint64_t lattice_graph_hash(Graph const & G) {
+                fnv1a_hash hash;
+                hash(num_vertices(G));
+                typename boost::graph_traits<Graph>::edge_iterator ei, ee;
+                for (boost::tie(ei, ee) = edges(G); ei != ee; ++ei) {
+                    hash(source(*ei, G));
+                    hash(target(*ei, G));
+                }
+                return hash.value();
+            }
+
+            template<typename Graph> boost::uint64_t lattice_graph_color_hash(Graph const & G) {
+                fnv1a_hash hash;
+                typename boost::graph_traits<Graph>::edge_iterator ei, ee;
+                for (boost::tie(ei, ee) = edges(G); ei != ee; ++ei)
+                    hash(get(alps::edge_type_t(), G, *ei));
+                return hash.value();
+            }
+
+            // Identifies the lattice graph G and the cell c of L whose vertices the embeddings are pinned to.
+            template<typename Graph, typename Lattice> std::string lattice_key(
+                  Graph const & G
+                , Lattice const & L
+                , typename alps::lattice_traits<Lattice>::cell_descriptor c
+            ) {
+                std::vector<typename boost::graph_traits<Graph>::vertex_descriptor> V(vertices_of_cell(c, L));
+                std::ostringstream os;
+                os << "vertices=" << num_vertices(G) << " edges=" << num_edges(G)
+                   << " graph=" << std::hex << lattice_graph_hash(G) << std::dec << " cell=";
+                for (std::size_t i = 0; i < V.size(); ++i)
+                    os << (i ? "," : "") << V[i];
+                return os.str();
+            }
+        }
+
+        /**
+          * lattice_constant_cache keeps the lattice constants of subgraphs in a text file, so that later runs do not recompute them.
+          * Each line of the file holds "lattice key<TAB>canonical label<TAB>lattice constant".
+          * The lattice key is derived from the lattice graph, the vertices of the cell the subgraphs are pinned to
+          * and, for colored subgraphs, the edge colors of the lattice graph and the color mapping (breakup).
+          * A cached value is only used if all of these match, so that one file can hold the lattice constants of several lattices.
+          * Lattice constants missing in the file are computed and appended to it.
+          * The lattice key hashes all edges of the lattice graph. When looking up many subgraphs on the same lattice and cell,
+          * compute it once with key_for and pass it to operator() instead of the lattice graph alone.
+          * The cache is not thread safe.
+          */
+        class lattice_constant_cache {
+            public:
+                lattice_constant_cache(std::string const & filename)
+                    : filename_(filename)
+                    , hits_(0)
+                    , misses_(0)
+                {
+                    std::ifstream in(filename_.c_str());
+                    std::string line;
+                    while (std::getline(in, line)) {
+                        if (line.empty())
+                            continue;
+                        std::string::size_type const first = line.find('\t');
+                        std::string::size_type const second = first == std::string::npos ? first : line.find('\t', first + 1);
+                        if (second == std::string::npos)
+                            throw std::runtime_error("invalid line in lattice constant cache " + filename_ + ": " + line);
+                        std::istringstream count(line.substr(second + 1));
+                        std::size_t value;
+                        if (!(count >> value))
+                            throw std::runtime_error("invalid lattice constant in lattice constant cache " + filename_ + ": " + line);
+                        counts_[line.substr(0, second)] = value;
+                    }
+                }
+
+                // The lattice part of the key for the subgraphs of G pinned to the cell c of L.
+                template<typename Graph, typename Lattice> static std::string key_for(
+                      Graph const & G
+                    , Lattice const & L
+                    , typename alps::lattice_traits<Lattice>::cell_descriptor c
+                ) {
+                    return detail::lattice_key(G, L, c);
+                }
+
+                // The lattice part of the key for colored subgraphs, including the edge colors of G and the color mapping.
+                template<typename Graph, typename Lattice> static std::string key_for(
+                      Graph const & G
+                    , Lattice const & L
+                    , typename alps::lattice_traits<Lattice>::cell_descriptor c
+                    , std::vector<alps::type_type> const & edge_color_mapping
+                ) {
+                    std::ostringstream os;
+                    os << detail::lattice_key(G, L, c) << " colors=" << std::hex << detail::lattice_graph_color_hash(G) << std::dec << " breakup=";
+                    for (std::size_t i = 0; i < edge_color_mapping.size(); ++i)
+                        os << (i ? "," : "") << edge_color_mapping[i];
+                    return os.str();
+                }
+
+                // key has to be key_for(G, L, c)
+                template<typename Subgraph, typename Graph, typename Lattice> std::size_t operator()(
+                      Subgraph const & S
+                    , std::string const & key
+                    , Graph const & G
+                    , Lattice const & L
+                    , typename alps::lattice_traits<Lattice>::cell_descriptor c
+                ) {
+                    std::string const full_key = key + '\t' + canonical_label(S);
+                    std::map<std::string, std::size_t>::const_iterator it = counts_.find(full_key);
+                    if (it != counts_.end()) {
+                        ++hits_;
+                        return it->second;
+                    }
+                    return insert(full_key, lattice_constant(S, G, L, c));
+                }
+
+                // key has to be key_for(G, L, c, edge_color_mapping)
+                template<typename Subgraph, typename Graph, typename Lattice> std::size_t operator()(
+                      Subgraph const & S
+                    , std::string const & key
+                    , Graph const & G
+                    , Lattice const & L
+                    , typename alps::lattice_traits<Lattice>::cell_descriptor c
+                    , std::vector<alps::type_type> const & edge_color_mapping
+                ) {
+                    std::string const full_key = key + '\t' + canonical_label(S);
+                    std::map<std::string, std::size_t>::const_iterator it = counts_.find(full_key);
+                    if (it != counts_.end()) {
+                        ++hits_;
+                        return it->second;
+                    }
+                    return insert(full_key, lattice_constant(S, G, L, c, edge_color_mapping));
+                }
+
+                template<typename Subgraph, typename Graph, typename Lattice> std::size_t operator()(
+                      Subgraph const & S
+                    , Graph const & G
+                    , Lattice const & L
+                    , typename alps::lattice_traits<Lattice>::cell_descriptor c
+                ) {
+                    return (*this)(S, key_for(G, L, c), G, L, c);
+                }
+
+                template<typename Subgraph, typename Graph, typename Lattice> std::size_t operator()(
+                      Subgraph const & S
+                    , Graph const & G
+                    , Lattice const & L
+                    , typename alps::lattice_traits<Lattice>::cell_descriptor c
+                    , std::vector<alps::type_type> const & edge_color_mapping
+                ) {
+                    return (*this)(S, key_for(G, L, c, edge_color_mapping), G, L, c, edge_color_mapping);
+                }
+
+                std::size_t size() const { return counts_.size(); }
+                std::size_t hits() const { return hits_; }
+                std::size_t misses() const { return misses_; }
+
+            private:
+                template<typename Subgraph> static std::string canonical_label(Subgraph const & S) {
+                    std::ostringstream os;
+                    os << get<alps::graph::label>(canonical_properties(S));
+                    return os.str();
+                }
+
+                std::size_t insert(std::string const & key, std::size_t value) {
+                    ++misses_;
+                    counts_.insert(std::make_pair(key, value));
+                    std::ofstream out(filename_.c_str(), std::ios::app);
+                    out << key << '\t' << value << std::endl;
+                    if (!out)
+                        throw std::runtime_error("could not write to lattice constant cache " + filename_);
+                    return value;
+                }
+
+                std::string filename_;
+                std::map<std::string, std::size_t> counts_;
+                std::size_t hits_;
+                std::size_t misses_;
+        };
+    }
+}
+
+#endif //ALPS_GRAPH_LATTICE_CONSTANT_CACHE_HPP
@@ -33,8 +33,13 @@
 #include <boost/static_assert.hpp>
 #include <alps/graph/lattice_constant.hpp>
 #include <alps/graph/is_embeddable.hpp>
+#include <alps/graph/detail/subgraph_label_table.hpp>
 #include <vector>
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
 namespace alps {
 namespace graph {
 
@@ -50,7 +55,7 @@ namespace detail {
         typedef typename std::vector<subgraph_properties_pair_type>::iterator iterator;
 
         subgraph_generator_impl_base(supergraph_type const& supergraph, std::vector<typename graph_traits<supergraph_type>::vertex_descriptor> const& possible_pins)
-            : supergraph_(supergraph), graphs_(), possible_pins_(possible_pins), non_embeddable_graphs_(), labels_()
+            : supergraph_(supergraph), graphs_(), possible_pins_(possible_pins), non_embeddable_graphs_(), labels_(), collect_candidates_(false)
         {
         }
 
@@ -68,6 +73,19 @@ namespace detail {
             return labels_.insert(boost::make_tuple(boost::get<0>(label).size(),label)).second;
         }
 
+        /*
+          * Handles a newly grown graph g.
+          * Usually g is appended to result if it is new and embeddable. While collect_candidates_ is set,
+          * g is appended to result in any case and the caller takes care of duplicates and embeddings.
+          * \param result the list of graphs grown in the current step
+          * \param g the new graph
+          * \param prop the canonical properties of g
+          */
+        void found(std::vector<subgraph_properties_pair_type>& result, subgraph_type const& g, typename canonical_properties_type<subgraph_type>::type const& prop) {
+            if(collect_candidates_ || (this->is_unknown(prop) && this->check_embedding(g,prop)))
+                result.push_back(std::make_pair(g,prop));
+        }
+
         /*
           * Checks whether the subgraph g is embeddable in the supergraph.
           * For small graphs g the graph may be added to an internal list of non-embeddable graphs if it is not embeddable.
@@ -77,9 +95,20 @@ namespace detail {
           * \return true if g is embeddable, false if g is not embeddable
           */
         bool check_embedding(subgraph_type const& g, typename canonical_properties_type<subgraph_type>::type const& prop) {
+            bool result = is_embeddable_in_supergraph(g,prop);
+            if(!result) // && num_edges(g) < 9)
+                non_embeddable_graphs_.push_back(std::make_pair(g,get<alps::graph::partition>(prop)));
+            return result;
+        }
+
+        /*
+          * Same as check_embedding, but does not modify the list of non-embeddable graphs,
+          * such that it may be called by several threads at once.
+          */
+        bool is_embeddable_in_supergraph(subgraph_type const& g, typename canonical_properties_type<subgraph_type>::type const& prop) {
             assert(prop == this->canonical_prop(g));
             typename graph_traits<subgraph_type>::edges_size_type const num_edges_g = num_edges(g);
-            for(typename std::vector<std::pair<subgraph_type,typename partition_type<subgraph_type>::type> >::iterator it= non_embeddable_graphs_.begin(); it != non_embeddable_graphs_.end(); ++it)
+            for(typename std::vector<std::pair<subgraph_type,typename partition_type<subgraph_type>::type> >::const_iterator it= non_embeddable_graphs_.begin(); it != non_embeddable_graphs_.end(); ++it)
             {
                 // Graphs of the same size can't be embedded into each other unless they are the same
                 if(num_edges(it->first) >= num_edges_g)
@@ -90,10 +119,7 @@ namespace detail {
                 if(this->try_to_embedd(it->first,g,it->second))
                     return false;
             }
-            bool result = this->try_to_embedd_in_supergraph(g,supergraph_,possible_pins_,boost::get<alps::graph::partition>(prop));
-            if(!result) // && num_edges(g) < 9)
-                non_embeddable_graphs_.push_back(std::make_pair(g,get<alps::graph::partition>(prop)));
-            return result;
+            return this->try_to_embedd_in_supergraph(g,supergraph_,possible_pins_,boost::get<alps::graph::partition>(prop));
         }
 
         /// The supergraph for which the subgraphs are generated
@@ -106,6 +132,8 @@ namespace detail {
         std::vector<std::pair<subgraph_type, typename partition_type<subgraph_type>::type> > non_embeddable_graphs_;
         /// a list of canonical graph labels of graphs that were seen
         std::set<boost::tuple<std::size_t, typename graph_label<subgraph_type>::type> > labels_;
+        /// set while the graphs of one step are grown by several threads
+        bool collect_candidates_;
     };
 
     template <typename SubGraph, typename SuperGraph, typename EdgeColorSymmetryPolicy, bool ColoredVertices, bool ColoredEdges>
@@ -164,8 +192,7 @@ namespace detail {
             subgraph_type new_graph(it->first);
             add_edge( v, add_vertex(new_graph), new_graph);
             canonical_properties_type const new_graph_prop = this->canonical_prop(new_graph);
-            if( this->is_unknown(new_graph_prop) && this->check_embedding(new_graph,new_graph_prop) )
-                result.push_back(std::make_pair(new_graph,new_graph_prop));
+            this->found(result,new_graph,new_graph_prop);
         }
 
         void grow_new_edges(std::vector<subgraph_properties_pair_type>& result, iterator const it, typename graph_traits<subgraph_type>::vertex_descriptor v,  typename partition_type<subgraph_type>::type::const_iterator const p_it)
@@ -187,8 +214,7 @@ namespace detail {
                     subgraph_type new_graph2(it->first);
                     add_edge( v2, v, new_graph2);
                     canonical_properties_type const new_graph2_prop = this->canonical_prop(new_graph2);
-                    if( this->is_unknown(new_graph2_prop) && this->check_embedding(new_graph2,new_graph2_prop) )
-                        result.push_back(std::make_pair(new_graph2,new_graph2_prop));
+                    this->found(result,new_graph2,new_graph2_prop);
                 }
             }
 
@@ -202,8 +228,7 @@ namespace detail {
                     subgraph_type new_graph2(it->first);
                     add_edge( v2, v, new_graph2);
                     canonical_properties_type const new_graph2_prop = this->canonical_prop(new_graph2);
-                    if( this->is_unknown(new_graph2_prop) && this->check_embedding(new_graph2,new_graph2_prop) )
-                        result.push_back(std::make_pair(new_graph2,new_graph2_prop));
+                    this->found(result,new_graph2,new_graph2_prop);
                 }
             }
         }
@@ -279,8 +304,7 @@ namespace detail {
             {
                 put( alps::edge_type_t(), new_graph, new_edge, *ecl_it);
                 canonical_properties_type const new_graph_prop = this->canonical_prop(new_graph);
-                if( this->is_unknown(new_graph_prop) && this->check_embedding(new_graph,new_graph_prop) )
-                    result.push_back(std::make_pair(new_graph,new_graph_prop));
+                this->found(result,new_graph,new_graph_prop);
             }
         }
 
@@ -306,8 +330,7 @@ namespace detail {
                     {
                         put( alps::edge_type_t(), new_graph2, new_edge, *ecl_it);
                         canonical_properties_type const new_graph2_prop = this->canonical_prop(new_graph2);
-                        if( this->is_unknown(new_graph2_prop) && this->check_embedding(new_graph2,new_graph2_prop) )
-                            result.push_back(std::make_pair(new_graph2,new_graph2_prop));
+                        this->found(result,new_graph2,new_graph2_prop);
                     }
                 }
             }
@@ -325,8 +348,7 @@ namespace detail {
                     {
                         put( alps::edge_type_t(), new_graph2, new_edge, *ecl_it);
                         canonical_properties_type const new_graph2_prop = this->canonical_prop(new_graph2);
-                        if( this->is_unknown(new_graph2_prop) && this->check_embedding(new_graph2,new_graph2_prop) )
-                            result.push_back(std::make_pair(new_graph2,new_graph2_prop));
+                        this->found(result,new_graph2,new_graph2_prop);
                     }
                 }
             }
@@ -522,6 +544,10 @@ class subgraph_generator
       std::vector<subgraph_properties_pair_type> generate_graphs_with_additional_edge(iterator it, iterator const end)
       {
           using boost::get;
+#ifdef _OPENMP
+          if(omp_get_max_threads() > 1)
+              return generate_graphs_with_additional_edge_parallel(it, end);
+#endif
           typedef typename graph_traits<subgraph_type>::vertex_descriptor vertex_descriptor;
           typedef typename partition_type<subgraph_type>::type            partition_type;
 
@@ -538,6 +564,50 @@ class subgraph_generator
           }
           return result;
       }
+
+    /**
+      * Same as generate_graphs_with_additional_edge, but the graphs of the range are distributed over the threads.
+      * The new graphs are deduplicated in a subgraph_label_table, which also restores the order of the serial version,
+      * and the embedding of each new label is checked by the thread which found it first.
+      * The non-embeddable graphs of the new size are only used as filters for larger graphs, so they are added
+      * to the list of non-embeddable graphs after all threads are done.
+      */
+      std::vector<subgraph_properties_pair_type> generate_graphs_with_additional_edge_parallel(iterator const begin, iterator const end)
+      {
+          using boost::get;
+          typedef typename partition_type<subgraph_type>::type            partition_type;
+          typedef detail::subgraph_label_table<subgraph_type>             table_type;
+
+          table_type table;
+          std::ptrdiff_t const n = end - begin;
+          this->collect_candidates_ = true;
+          #pragma omp parallel for schedule(dynamic, 1)
+          for(std::ptrdiff_t i = 0; i < n; ++i)
+          {
+              iterator const it = begin + i;
+              std::vector<subgraph_properties_pair_type> candidates;
+              partition_type const& graph_partition = get<alps::graph::partition>(it->second);
+              for (typename partition_type::const_iterator p_it = graph_partition.begin(); p_it != graph_partition.end(); ++p_it)
+                  this->grow_at(candidates, it, *(p_it->begin()), p_it);
+              for(std::size_t j = 0; j < candidates.size(); ++j)
+                  if(table.offer(typename table_type::key_type(i,j), candidates[j]))
+                      table.set_embeddable(get<alps::graph::label>(candidates[j].second), this->is_embeddable_in_supergraph(candidates[j].first, candidates[j].second));
+          }
+          this->collect_candidates_ = false;
+
+          std::vector<typename table_type::entry const*> const entries(table.sorted_entries());
+          std::vector<subgraph_properties_pair_type> result;
+          for(typename std::vector<typename table_type::entry const*>::const_iterator e_it = entries.begin(); e_it != entries.end(); ++e_it)
+          {
+              subgraph_properties_pair_type const& g = (*e_it)->graph;
+              this->is_unknown(g.second);
+              if((*e_it)->embeddable)
+                  result.push_back(g);
+              else
+                  this->non_embeddable_graphs_.push_back(std::make_pair(g.first,get<alps::graph::partition>(g.second)));
+          }
+          return result;
+      }
 };
 
 template <typename SubGraph, typename SuperGraph>
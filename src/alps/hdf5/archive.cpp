@@ -41,17 +41,26 @@
 #include <iostream>
 #include <typeinfo>
 
+// The static mutex_ only protects the table of open files. Every open file
+// has its own lock, so archives of different files do not wait for each
+// other. If HDF5 is not built thread safe, the library lock serializes all
+// calls into HDF5 in addition. It is only held around the calls into HDF5,
+// not while the file of a 'w' archive is copied, removed or renamed.
 #ifdef ALPS_NGS_SINGLE_THREAD
     #define ALPS_HDF5_LOCK_MUTEX
+    #define ALPS_HDF5_LOCK_FILE
+    #define ALPS_HDF5_LOCK_LIBRARY
 #else
-    #define ALPS_HDF5_LOCK_MUTEX boost::lock_guard<boost::recursive_mutex> guard(mutex_);
+    #define ALPS_HDF5_LOCK_MUTEX boost::unique_lock<boost::mutex> guard(mutex_);
+    #define ALPS_HDF5_LOCK_FILE detail::file_lock file_guard(context_);
+    #ifdef H5_HAVE_THREADSAFE
+        #define ALPS_HDF5_LOCK_LIBRARY
+    #else
+        #define ALPS_HDF5_LOCK_LIBRARY boost::lock_guard<boost::recursive_mutex> library_guard(detail::library_mutex);
+    #endif
 #endif
 
-#ifdef H5_HAVE_THREADSAFE
-    #define ALPS_HDF5_FAKE_THREADSAFETY
-#else
-    #define ALPS_HDF5_FAKE_THREADSAFETY ALPS_HDF5_LOCK_MUTEX
-#endif
+#define ALPS_HDF5_FAKE_THREADSAFETY ALPS_HDF5_LOCK_FILE ALPS_HDF5_LOCK_LIBRARY
 
 #define ALPS_NGS_HDF5_FOREACH_NATIVE_TYPE_INTEGRAL(CALLBACK, ARG)                                                                                                       \
     CALLBACK(char, ARG)                                                                                                                                                 \
@@ -79,6 +88,11 @@ namespace alps {
                 return 0; 
             }
 
+            #ifndef ALPS_NGS_SINGLE_THREAD
+                boost::recursive_mutex library_mutex;
+                boost::condition_variable file_released;
+            #endif
+
             template<typename T> struct native_ptr_converter {
                 native_ptr_converter(std::size_t) {}
                 inline T const * apply(T const * v) {
@@ -251,6 +265,9 @@ namespace alps {
                 std::string filename_;
                 std::string suffix_;
                 hid_t file_id_;
+                #ifndef ALPS_NGS_SINGLE_THREAD
+                    boost::recursive_mutex mutex_;
+                #endif
                 
                 private:
 
@@ -259,6 +276,7 @@ namespace alps {
                         if (memory_ && large_)
                             throw archive_error("either memory or large file system can be used!" + ALPS_STACKTRACE);
                         else if (memory_) {
+                            ALPS_HDF5_LOCK_LIBRARY
                             detail::property_type prop_id(H5Pcreate(H5P_FILE_ACCESS));
                             detail::check_error(H5Pset_fapl_core(prop_id, 1 << 20, true));
                             #ifndef ALPS_HDF5_CLOSE_GREEDY
@@ -290,6 +308,7 @@ namespace alps {
                                     if (!strcmp(filename0, filename1))
                                         throw archive_error("Large hdf5 archives need to have a '%d' part in the filename" + ALPS_STACKTRACE);
                                 }
+                                ALPS_HDF5_LOCK_LIBRARY
                                 detail::property_type prop_id(H5Pcreate(H5P_FILE_ACCESS));
                                 detail::check_error(H5Pset_fapl_family(prop_id, 1 << 30, H5P_DEFAULT));
                                 #ifndef ALPS_HDF5_CLOSE_GREEDY
@@ -307,12 +326,11 @@ namespace alps {
                                 else
                                     detail::check_error(file_id_);
                             } else {
-                                if (!write_) {
-                                    if (!boost::filesystem::exists(filename_ + suffix_))
-                                        throw archive_not_found("file does not exist: " + filename_ + suffix_ + ALPS_STACKTRACE);
-                                    if (detail::check_error(H5Fis_hdf5((filename_ + suffix_).c_str())) == 0)
-                                        throw archive_error("no valid hdf5 file: " + filename_ + suffix_ + ALPS_STACKTRACE);
-                                }
+                                if (!write_ && !boost::filesystem::exists(filename_ + suffix_))
+                                    throw archive_not_found("file does not exist: " + filename_ + suffix_ + ALPS_STACKTRACE);
+                                ALPS_HDF5_LOCK_LIBRARY
+                                if (!write_ && detail::check_error(H5Fis_hdf5((filename_ + suffix_).c_str())) == 0)
+                                    throw archive_error("no valid hdf5 file: " + filename_ + suffix_ + ALPS_STACKTRACE);
                                 #ifndef ALPS_HDF5_CLOSE_GREEDY
                                     detail::property_type ALPS_HDF5_FILE_ACCESS(H5Pcreate(H5P_FILE_ACCESS));
                                     detail::check_error(H5Pset_fclose_degree(ALPS_HDF5_FILE_ACCESS, H5F_CLOSE_SEMI));
@@ -337,27 +355,30 @@ namespace alps {
 
                     void destruct(bool abort) {
                         try {
-                            H5Fflush(file_id_, H5F_SCOPE_GLOBAL);
-                            #ifndef ALPS_HDF5_CLOSE_GREEDY
-                                if (
-                                       H5Fget_obj_count(file_id_, H5F_OBJ_DATATYPE) > 0
-                                    || H5Fget_obj_count(file_id_, H5F_OBJ_ALL) - H5Fget_obj_count(file_id_, H5F_OBJ_FILE) > 0
-                                ) {
-                                    std::cerr << "Not all resources closed in file '" << filename_ << suffix_ << "'" << std::endl;
-                                    std::abort();
-                                }
-                            #endif
-                            if (H5Fclose(file_id_) < 0)
-                                std::cerr << "Error in " 
-                                          << __FILE__ 
-                                          << " on " 
-                                          << ALPS_NGS_STRINGIFY(__LINE__) 
-                                          << " in " 
-                                          << __FUNCTION__ // TODO: check for gcc and use __PRETTY_FUNCTION__  
-                                          << ":" 
-                                          << std::endl
-                                          << error().invoke(file_id_)
-                                          << std::endl;
+                            {
+                                ALPS_HDF5_LOCK_LIBRARY
+                                H5Fflush(file_id_, H5F_SCOPE_GLOBAL);
+                                #ifndef ALPS_HDF5_CLOSE_GREEDY
+                                    if (
+                                           H5Fget_obj_count(file_id_, H5F_OBJ_DATATYPE) > 0
+                                        || H5Fget_obj_count(file_id_, H5F_OBJ_ALL) - H5Fget_obj_count(file_id_, H5F_OBJ_FILE) > 0
+                                    ) {
+                                        std::cerr << "Not all resources closed in file '" << filename_ << suffix_ << "'" << std::endl;
+                                        std::abort();
+                                    }
+                                #endif
+                                if (H5Fclose(file_id_) < 0)
+                                    std::cerr << "Error in " 
+                                              << __FILE__ 
+                                              << " on " 
+                                              << ALPS_NGS_STRINGIFY(__LINE__) 
+                                              << " in " 
+                                              << __FUNCTION__ // TODO: check for gcc and use __PRETTY_FUNCTION__  
+                                              << ":" 
+                                              << std::endl
+                                              << error().invoke(file_id_)
+                                              << std::endl;
+                            }
                             if (replace_) {
                                 if (boost::filesystem::exists(filename_))
                                     boost::filesystem::remove(filename_);
@@ -373,6 +394,26 @@ namespace alps {
                     }
             };
 
+            #ifndef ALPS_NGS_SINGLE_THREAD
+                class file_lock : boost::noncopyable {
+                    public:
+                        file_lock(archivecontext * context)
+                            : mutex_(context == NULL ? NULL : &context->mutex_)
+                        {
+                            if (mutex_ != NULL)
+                                mutex_->lock();
+                        }
+
+                        ~file_lock() {
+                            if (mutex_ != NULL)
+                                mutex_->unlock();
+                        }
+
+                    private:
+                        boost::recursive_mutex * mutex_;
+                };
+            #endif
+
         }
 
         archive::archive(std::string const & filename, int props) { // TODO: remove that!
@@ -433,6 +474,8 @@ namespace alps {
         void archive::abort() {
             // Do not use a lock here, else deadlocking is really likly
             for (std::map<std::string, std::pair<detail::archivecontext *, std::size_t> >::iterator it = ref_cnt_.begin(); it != ref_cnt_.end(); ++it) {
+                if (it->second.first == NULL)
+                    continue;
                 bool replace = it->second.first->replace_;
                 std::string filename = it->second.first->filename_;
                 it->second.first->replace_ = false;
@@ -446,11 +489,26 @@ namespace alps {
         void archive::close() {
             if (context_ == NULL)
                 throw archive_closed("the archive is closed" + ALPS_STACKTRACE);
-            ALPS_HDF5_LOCK_MUTEX
-            H5Fflush(context_->file_id_, H5F_SCOPE_GLOBAL);
-            if (!--ref_cnt_[file_key(context_->filename_, context_->large_, context_->memory_)].second) {
-                ref_cnt_.erase(file_key(context_->filename_, context_->large_, context_->memory_));
+            std::string key = file_key(context_->filename_, context_->large_, context_->memory_);
+            {
+                ALPS_HDF5_FAKE_THREADSAFETY
+                H5Fflush(context_->file_id_, H5F_SCOPE_GLOBAL);
+            }
+            bool last;
+            {
+                ALPS_HDF5_LOCK_MUTEX
+                std::pair<detail::archivecontext *, std::size_t> & entry = ref_cnt_[key];
+                // an entry without context marks a file that is being opened or closed
+                if ((last = !--entry.second))
+                    entry.first = NULL;
+            }
+            if (last) {
                 delete context_;
+                ALPS_HDF5_LOCK_MUTEX
+                ref_cnt_.erase(key);
+                #ifndef ALPS_NGS_SINGLE_THREAD
+                    detail::file_released.notify_all();
+                #endif
             }
             context_ = NULL;
         }
@@ -486,7 +544,6 @@ namespace alps {
         }
     
         void archive::set_context(std::string const & context) {
-            ALPS_HDF5_LOCK_MUTEX
             current_ = complete_path(context);
         }
     
@@ -1309,31 +1366,60 @@ namespace alps {
                     throw path_not_found("no valid path: " + path + ALPS_STACKTRACE);                                                                                   \
                 detail::type_type native_id(H5Tget_native_type(type_id, H5T_DIR_ASCEND));                                                                               \
                 detail::check_type(type_id);                                                                                                                            \
-                {                                                                                                                                                       \
-                    ALPS_HDF5_LOCK_MUTEX                                                                                                                                \
-                    return detail::is_datatype_impl_compare< T >::apply(native_id);                                                                                     \
-                }                                                                                                                                                       \
+                return detail::is_datatype_impl_compare< T >::apply(native_id);                                                                                         \
             }
         ALPS_NGS_FOREACH_NATIVE_HDF5_TYPE(ALPS_NGS_HDF5_IS_DATATYPE_IMPL_IMPL)
         #undef ALPS_NGS_HDF5_IS_DATATYPE_IMPL_IMPL
 
         void archive::construct(std::string const & filename, std::size_t props) {
-            ALPS_HDF5_LOCK_MUTEX
-            detail::check_error(H5Eset_auto2(H5E_DEFAULT, NULL, NULL));
-            if (props & COMPRESS) {
-                unsigned int flag;
-                detail::check_error(H5Zget_filter_info(H5Z_FILTER_SZIP, &flag));
-                props &= (flag & H5Z_FILTER_CONFIG_ENCODE_ENABLED ? ~0x00 : ~COMPRESS);
+            {
+                ALPS_HDF5_LOCK_LIBRARY
+                detail::check_error(H5Eset_auto2(H5E_DEFAULT, NULL, NULL));
+                if (props & COMPRESS) {
+                    unsigned int flag;
+                    detail::check_error(H5Zget_filter_info(H5Z_FILTER_SZIP, &flag));
+                    props &= (flag & H5Z_FILTER_CONFIG_ENCODE_ENABLED ? ~0x00 : ~COMPRESS);
+                }
             }
-            if (ref_cnt_.find(file_key(filename, props & LARGE, props & MEMORY)) == ref_cnt_.end())
-                ref_cnt_.insert(std::make_pair(
-                      file_key(filename, props & LARGE, props & MEMORY)
-                    , std::make_pair(context_ = new detail::archivecontext(filename, props & WRITE, props & REPLACE, props & COMPRESS, props & LARGE, props & MEMORY), 1)
-                ));
-            else {
-                context_ = ref_cnt_.find(file_key(filename, props & LARGE, props & MEMORY))->second.first;
+            std::string key = file_key(filename, props & LARGE, props & MEMORY);
+            {
+                ALPS_HDF5_LOCK_MUTEX
+                std::map<std::string, std::pair<detail::archivecontext *, std::size_t> >::iterator it;
+                #ifndef ALPS_NGS_SINGLE_THREAD
+                    while ((it = ref_cnt_.find(key)) != ref_cnt_.end() && it->second.first == NULL)
+                        detail::file_released.wait(guard);
+                #else
+                    it = ref_cnt_.find(key);
+                #endif
+                if (it != ref_cnt_.end()) {
+                    context_ = it->second.first;
+                    ++it->second.second;
+                } else {
+                    ref_cnt_.insert(std::make_pair(key, std::make_pair(static_cast<detail::archivecontext *>(NULL), 1)));
+                    context_ = NULL;
+                }
+            }
+            if (context_ != NULL) {
+                ALPS_HDF5_LOCK_FILE
                 context_->grant(props & WRITE, props & REPLACE);
-                ++ref_cnt_.find(file_key(filename, props & LARGE, props & MEMORY))->second.second;
+            } else {
+                // open the file without holding the lock of the file table
+                detail::archivecontext * context;
+                try {
+                    context = new detail::archivecontext(filename, props & WRITE, props & REPLACE, props & COMPRESS, props & LARGE, props & MEMORY);
+                } catch (...) {
+                    ALPS_HDF5_LOCK_MUTEX
+                    ref_cnt_.erase(key);
+                    #ifndef ALPS_NGS_SINGLE_THREAD
+                        detail::file_released.notify_all();
+                    #endif
+                    throw;
+                }
+                ALPS_HDF5_LOCK_MUTEX
+                ref_cnt_[key].first = context_ = context;
+                #ifndef ALPS_NGS_SINGLE_THREAD
+                    detail::file_released.notify_all();
+                #endif
             }
         }
 
@@ -1342,7 +1428,7 @@ namespace alps {
         }
     
 #ifndef ALPS_NGS_SINGLE_THREAD
-        boost::recursive_mutex archive::mutex_;
+        boost::mutex archive::mutex_;
 #endif
         std::map<std::string, std::pair<detail::archivecontext *, std::size_t> > archive::ref_cnt_;
     }
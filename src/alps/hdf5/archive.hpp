@@ -227,7 +227,7 @@ namespace alps {
                 detail::archivecontext * context_;
 
 #ifndef ALPS_NGS_SINGLE_THREAD
-                static boost::recursive_mutex mutex_;
+                static boost::mutex mutex_;
 #endif
                 static std::map<std::string, std::pair<detail::archivecontext *, std::size_t> > ref_cnt_;
 
@@ -32,4 +32,5 @@
 /// \brief includes all headers in the alps/lattice directory
 
 #include <alps/lattice/graph_helper.h>
+#include <alps/lattice/csr_graph.h>
 #include <alps/lattice/parity.h>
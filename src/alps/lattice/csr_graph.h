@@ -0,0 +1,255 @@
+/*****************************************************************************
+*
+* ALPS Project: Algorithms and Libraries for Physics Simulations
+*
+* ALPS Libraries
+*
+* Copyright (C) 2001-2009 by Matthias Troyer <troyer@itp.phys.ethz.ch>,
+*                            Synge Todo <wistaria@comp-phys.org>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+* 
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT 
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE 
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE, 
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+
+/* $Id$ */
+
+/// \file csr_graph.h
+/// \brief an immutable lattice graph stored in compressed sparse row format
+
+#ifndef ALPS_LATTICE_CSR_GRAPH_H
+#define ALPS_LATTICE_CSR_GRAPH_H
+
+#include <alps/config.h>
+#include <alps/lattice/graph_helper.h>
+#include <boost/cstdint.hpp>
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace alps {
+
+/// \brief a bond of a csr_graph together with the direction it is traversed in
+///
+/// The bond with index b is stored as the half-edges 2*b, running from the
+/// source to the target of the bond, and 2*b+1, running the other way.
+class csr_bond_descriptor
+{
+public:
+  csr_bond_descriptor() : e_(0) {}
+  explicit csr_bond_descriptor(unsigned int e) : e_(e) {}
+  /// the index of the bond
+  unsigned int bond() const { return e_ >> 1; }
+  /// true if the bond is traversed from its target to its source
+  bool reversed() const { return e_ & 1; }
+  unsigned int half_edge() const { return e_; }
+  bool operator==(const csr_bond_descriptor& x) const { return e_ == x.e_; }
+  bool operator!=(const csr_bond_descriptor& x) const { return e_ != x.e_; }
+  bool operator<(const csr_bond_descriptor& x) const { return e_ < x.e_; }
+private:
+  unsigned int e_;
+};
+
+namespace detail {
+struct csr_bond_of_index
+{
+  typedef csr_bond_descriptor result_type;
+  csr_bond_descriptor operator()(unsigned int b) const { return csr_bond_descriptor(2*b); }
+};
+} // end namespace detail
+
+/// \brief a compact, immutable copy of the graph of a graph_helper
+///
+/// Sites and bonds are numbered by their index in the graph_helper. All
+/// properties are kept in contiguous arrays indexed by site or bond number,
+/// and the neighbors of site s are neighbor_[offset_[s]] ... neighbor_[offset_[s+1]-1],
+/// in the same order as graph_helper::neighbors(s). Iterating over neighbors
+/// therefore walks one array instead of the edge lists of an adjacency_list.
+///
+/// The member functions have the same names and meaning as those of graph_helper.
+/// Site descriptors are the site indices. Bond descriptors are half-edges, as
+/// the out-edges of an undirected adjacency_list: bonds() yields every bond
+/// in its stored orientation, while for a bond b in neighbor_bonds(s)
+/// source(b) is s and target(b) is the neighbor. All other bond properties,
+/// including bond_vector, are those of the stored bond. index(b) gives the
+/// bond number.
+class csr_graph
+{
+public:
+  typedef unsigned int site_descriptor;
+  typedef csr_bond_descriptor bond_descriptor;
+  typedef std::size_t sites_size_type;
+  typedef std::size_t bonds_size_type;
+  typedef std::size_t neighbors_size_type;
+  typedef boost::counting_iterator<site_descriptor> site_iterator;
+  typedef boost::transform_iterator<detail::csr_bond_of_index,
+            boost::counting_iterator<unsigned int> > bond_iterator;
+  typedef const site_descriptor* neighbor_iterator;
+  typedef const bond_descriptor* neighbor_bond_iterator;
+  typedef std::vector<double> vector_type;
+
+  csr_graph() : dimension_(0), is_bipartite_(false), offset_(1, 0) {}
+
+  template <class G>
+  explicit csr_graph(const graph_helper<G>& h)
+    : dimension_(h.dimension()),
+      is_bipartite_(h.is_bipartite()),
+      site_type_(h.num_sites()),
+      parity_(h.num_sites()),
+      coordinate_(h.num_sites()*h.dimension(), 0.),
+      offset_(h.num_sites()+1, 0),
+      source_(h.num_bonds()),
+      target_(h.num_bonds()),
+      bond_type_(h.num_bonds()),
+      bond_vector_(h.num_bonds()*h.dimension(), 0.),
+      bond_vector_relative_(h.num_bonds()*h.dimension(), 0.)
+  {
+    typedef graph_helper<G> helper_type;
+    if (h.inhomogeneous_sites())
+      inhomogeneous_site_type_.resize(h.num_sites());
+    if (h.inhomogeneous_bonds())
+      inhomogeneous_bond_type_.resize(h.num_bonds());
+
+    for (sites_size_type i = 0; i < h.num_sites(); ++i) {
+      typename helper_type::site_descriptor s = h.site(i);
+      site_type_[i] = h.site_type(s);
+      if (!inhomogeneous_site_type_.empty())
+        inhomogeneous_site_type_[i] = h.inhomogeneous_site_type(s);
+      parity_[i] = static_cast<int8_t>(h.parity(s));
+      copy_vector(h.coordinate(s), coordinate_.begin() + i*dimension_);
+      offset_[i+1] = offset_[i] + h.num_neighbors(s);
+    }
+
+    for (bonds_size_type i = 0; i < h.num_bonds(); ++i) {
+      typename helper_type::bond_descriptor b = h.bond(i);
+      source_[i] = h.index(h.source(b));
+      target_[i] = h.index(h.target(b));
+      bond_type_[i] = h.bond_type(b);
+      if (!inhomogeneous_bond_type_.empty())
+        inhomogeneous_bond_type_[i] = h.inhomogeneous_bond_type(b);
+      copy_vector(h.bond_vector(b), bond_vector_.begin() + i*dimension_);
+      copy_vector(h.bond_vector_relative(b), bond_vector_relative_.begin() + i*dimension_);
+    }
+
+    neighbor_.resize(offset_.back());
+    neighbor_bond_.resize(offset_.back());
+    for (sites_size_type i = 0; i < h.num_sites(); ++i) {
+      typename helper_type::site_descriptor s = h.site(i);
+      std::size_t k = offset_[i];
+      typename helper_type::neighbor_iterator nit = h.neighbors(s).first;
+      typename helper_type::neighbor_bond_iterator bit, bend;
+      for (boost::tie(bit, bend) = h.neighbor_bonds(s); bit != bend; ++bit, ++nit, ++k) {
+        neighbor_[k] = h.index(*nit);
+        unsigned int b = h.index(*bit);
+        // the half-edge that starts at s; a bond from s to itself keeps its orientation
+        neighbor_bond_[k] = bond_descriptor(2*b + (source_[b] == i ? 0 : 1));
+      }
+    }
+  }
+
+  std::size_t dimension() const { return dimension_; }
+  bool is_bipartite() const { return is_bipartite_; }
+
+  sites_size_type num_sites() const { return site_type_.size(); }
+  bonds_size_type num_bonds() const { return source_.size(); }
+  std::pair<site_iterator, site_iterator> sites() const
+  { return std::make_pair(site_iterator(0), site_iterator(num_sites())); }
+  site_descriptor site(sites_size_type i) const { return i; }
+  std::pair<bond_iterator, bond_iterator> bonds() const
+  {
+    return std::make_pair(bond_iterator(boost::counting_iterator<unsigned int>(0)),
+                          bond_iterator(boost::counting_iterator<unsigned int>(num_bonds())));
+  }
+  bond_descriptor bond(bonds_size_type i) const { return bond_descriptor(2*i); }
+  site_descriptor source(bond_descriptor b) const
+  { return b.reversed() ? target_[b.bond()] : source_[b.bond()]; }
+  site_descriptor target(bond_descriptor b) const
+  { return b.reversed() ? source_[b.bond()] : target_[b.bond()]; }
+  sites_size_type index(site_descriptor s) const { return s; }
+  bonds_size_type index(bond_descriptor b) const { return b.bond(); }
+
+  neighbors_size_type num_neighbors(site_descriptor s) const
+  { return offset_[s+1] - offset_[s]; }
+  std::pair<neighbor_iterator, neighbor_iterator> neighbors(site_descriptor s) const
+  { return std::make_pair(data(neighbor_) + offset_[s], data(neighbor_) + offset_[s+1]); }
+  site_descriptor neighbor(site_descriptor s, neighbors_size_type i) const
+  { return neighbor_[offset_[s] + i]; }
+  std::pair<neighbor_bond_iterator, neighbor_bond_iterator> neighbor_bonds(site_descriptor s) const
+  { return std::make_pair(data(neighbor_bond_) + offset_[s], data(neighbor_bond_) + offset_[s+1]); }
+
+  double parity(site_descriptor s) const { return parity_[s]; }
+
+  type_type site_type(site_descriptor s) const { return site_type_[s]; }
+  type_type bond_type(bond_descriptor b) const { return bond_type_[b.bond()]; }
+  bool inhomogeneous_sites() const { return !inhomogeneous_site_type_.empty(); }
+  bool inhomogeneous_bonds() const { return !inhomogeneous_bond_type_.empty(); }
+  type_type inhomogeneous_site_type(site_descriptor s) const
+  { return inhomogeneous_sites() ? inhomogeneous_site_type_[s] : site_type_[s]; }
+  type_type inhomogeneous_bond_type(bond_descriptor b) const
+  { return inhomogeneous_bonds() ? inhomogeneous_bond_type_[b.bond()] : bond_type_[b.bond()]; }
+
+  vector_type coordinate(site_descriptor s) const
+  { return vector_type(data(coordinate_) + s*dimension_, data(coordinate_) + (s+1)*dimension_); }
+  double coordinate(site_descriptor s, unsigned int i) const { return coordinate_[s*dimension_ + i]; }
+  vector_type bond_vector(bond_descriptor b) const
+  {
+    const double* v = data(bond_vector_) + b.bond()*dimension_;
+    return vector_type(v, v + dimension_);
+  }
+  double bond_vector(bond_descriptor b, unsigned int i) const
+  { return bond_vector_[b.bond()*dimension_ + i]; }
+  vector_type bond_vector_relative(bond_descriptor b) const
+  {
+    const double* v = data(bond_vector_relative_) + b.bond()*dimension_;
+    return vector_type(v, v + dimension_);
+  }
+  double bond_vector_relative(bond_descriptor b, unsigned int i) const
+  { return bond_vector_relative_[b.bond()*dimension_ + i]; }
+
+private:
+  template <class T>
+  static const T* data(const std::vector<T>& v) { return v.empty() ? 0 : &v[0]; }
+
+  // copies at most dimension_ components, missing ones stay zero
+  void copy_vector(const vector_type& v, std::vector<double>::iterator out) const
+  { std::copy(v.begin(), v.begin() + std::min<std::size_t>(v.size(), dimension_), out); }
+
+  std::size_t dimension_;
+  bool is_bipartite_;
+
+  std::vector<type_type> site_type_;
+  std::vector<type_type> inhomogeneous_site_type_;  // empty unless the site types are disordered
+  std::vector<int8_t> parity_;
+  std::vector<double> coordinate_;                  // coordinate_[s*dimension_+i]
+  std::vector<std::size_t> offset_;                 // neighbors of s start at offset_[s]
+  std::vector<site_descriptor> neighbor_;
+  std::vector<bond_descriptor> neighbor_bond_;      // half-edges starting at the site
+
+  std::vector<site_descriptor> source_;
+  std::vector<site_descriptor> target_;
+  std::vector<type_type> bond_type_;
+  std::vector<type_type> inhomogeneous_bond_type_;  // empty unless the bond types are disordered
+  std::vector<double> bond_vector_;                 // bond_vector_[b*dimension_+i]
+  std::vector<double> bond_vector_relative_;
+};
+
+} // end namespace alps
+
+#endif // ALPS_LATTICE_CSR_GRAPH_H
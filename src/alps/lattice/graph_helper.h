@@ -480,6 +480,16 @@ public:
   { return inhomogeneous_edge_type(b); }
 
   const vector_type& coordinate(const site_descriptor& s) const { return coordinate_map_[s];}
+  // i-th coordinate of a site, read from the contiguous coordinate array
+  double coordinate(const site_descriptor& s, unsigned int i) const
+  { return flat_coordinates()[std::size_t(s)*dimension()+i]; }
+  // coordinates of all sites in one contiguous array, the i-th coordinate of site s is at s*dimension()+i
+  const std::vector<double>& flat_coordinates() const
+  {
+    if (flat_coordinates_.empty() && num_sites())
+      calculate_flat_coordinates();
+    return flat_coordinates_;
+  }
   std::string coordinate_string(const site_descriptor& s, int precision = 0) const {
     return coordinate_to_string(coordinate(s), precision);
   }
@@ -578,21 +588,47 @@ public:
     return alps::bond_labels(graph(), precision);
   }
 
+  // The distance class of two sites on a lattice only depends on the offsets of their cells and their
+  // positions in the unit cell. Instead of a num_sites() x num_sites() table we store the cell offsets
+  // and compute the same index as lattice_graph::distance from them.
   size_type distance(vertex_descriptor x, vertex_descriptor y) const
   {
     if (inhomogeneous() ||!have_lattice_)
       return size_type(x)*num_sites()+size_type(y);
     if (!distances_calculated_)
       calculate_distances();
-    return distance_lookup_[int(x)][int(y)];
+    const std::size_t dim = distance_extent_.size();
+    const int* ox = &cell_offsets_[(size_type(x)/vertices_in_cell_)*dim];
+    const int* oy = &cell_offsets_[(size_type(y)/vertices_in_cell_)*dim];
+    size_type d=0;
+    for (std::size_t i=0;i<dim;++i) {
+      const size_type l = distance_extent_[i];
+      if (distance_periodic_[i])
+        d = d*l + (ox[i] <= oy[i] ? oy[i]-ox[i] : l+oy[i]-ox[i]);
+      else
+        d = l*(d*l+ox[i])+oy[i];
+    }
+    return (d*vertices_in_cell_ + size_type(x)%vertices_in_cell_)*vertices_in_cell_ + size_type(y)%vertices_in_cell_;
   }
 
   void calculate_distances() const
   {
-    distance_lookup_.resize(boost::extents[num_sites()][num_sites()]);
-    for (vertex_iterator it1=vertices().first; it1 != vertices().second;++it1)
-      for (vertex_iterator it2=vertices().first; it2 != vertices().second;++it2)
-        distance_lookup_[int(*it1)][int(*it2)]=(have_lattice_ && !inhomogeneous() ? l_.distance(*it1,*it2) : (*it1)*num_sites()+(*it2));
+    if (have_lattice_ && !inhomogeneous()) {
+      const std::size_t dim = alps::dimension(lattice());
+      vertices_in_cell_ = num_vertices(alps::graph::graph(unit_cell()));
+      distance_extent_.resize(dim);
+      distance_periodic_.resize(dim);
+      for (std::size_t i=0;i<dim;++i) {
+        distance_extent_[i] = l_.extent(i);
+        distance_periodic_[i] = (l_.boundary(i)=="periodic");
+      }
+      cell_offsets_.resize(volume()*dim);
+      for (cell_iterator it=cells().first; it != cells().second; ++it) {
+        const cell_descriptor c = *it;
+        const offset_type& o = offset(c);
+        std::copy(o.begin(), o.end(), cell_offsets_.begin()+index(c)*dim);
+      }
+    }
     distances_calculated_=true;
   }
 
@@ -642,6 +678,15 @@ private:
   const graph_helper& operator=(const graph_helper&) {return *this;}
     graph_type* make_graph(const Parameters& p);
   const graph_type& const_graph() const { return *g_;}
+  void calculate_flat_coordinates() const
+  {
+    const std::size_t dim = dimension();
+    flat_coordinates_.assign(num_sites()*dim, 0.);
+    for (site_iterator it=sites().first; it != sites().second; ++it) {
+      const vector_type& c = coordinate(*it);
+      std::copy(c.begin(), c.begin()+std::min<std::size_t>(c.size(),dim), flat_coordinates_.begin()+std::size_t(*it)*dim);
+    }
+  }
 
   lattice_type l_;
   bool to_delete_;
@@ -659,7 +704,11 @@ private:
   inhomogeneous_edge_type_map_type inhomogeneous_edge_type_map_;
   bool have_lattice_;
   mutable bool distances_calculated_;
-  mutable boost::multi_array<size_type,2> distance_lookup_;
+  mutable size_type vertices_in_cell_;
+  mutable std::vector<size_type> distance_extent_;
+  mutable std::vector<bool> distance_periodic_;
+  mutable std::vector<int> cell_offsets_;       // offset of each cell, cell_offsets_[index(c)*dimension+i]
+  mutable std::vector<double> flat_coordinates_;
 };
 
 
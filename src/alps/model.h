@@ -34,3 +34,4 @@
 #include <alps/model/model_helper.h>
 #include <alps/model/blochbasisstates.h>
 #include <alps/model/sign.h>
+#include <alps/model/compiled_expression_cache.h>
@@ -33,6 +33,7 @@
 
 #include <alps/model/basisdescriptor.h>
 #include <alps/model/integer_state.h>
+#include <alps/model/state_lookup.h>
 #include <algorithm>
 
 namespace alps {
@@ -68,19 +69,26 @@ public:
   basis_states() {}
   template <class J>
   basis_states(const basis_states_descriptor<I,SS>& b,
-              const std::vector<std::pair<std::string,half_integer<J> > >& c)
+              const std::vector<std::pair<std::string,half_integer<J> > >& c,
+              state_lookup_type lookup=binary_search_lookup)
     : basis_descriptor_(b)
-  { build(c);}
+  { 
+    build(c);
+    lookup_ = state_lookup<I>(lookup,basis_descriptor_,*this);
+  }
 
-  basis_states(const basis_states_descriptor<I,SS>& b)
+  basis_states(const basis_states_descriptor<I,SS>& b, state_lookup_type lookup=binary_search_lookup)
     : basis_descriptor_(b)
   {
     build(b.get_basis().constraints());
+    lookup_ = state_lookup<I>(lookup,basis_descriptor_,*this);
   }
 
 
   inline std::size_t index(const value_type& x) const
   {
+    if (lookup_.type() != binary_search_lookup)
+      return lookup_.find(x);
     const_iterator it = std::lower_bound(super_type::begin(), super_type::end(), x);
     if (it==super_type::end())
       return super_type::size();
@@ -98,6 +106,7 @@ public:
 
   bool check_sort() const;
   const basis_type& basis() const { return basis_descriptor_;}
+  state_lookup_type lookup_type() const { return lookup_.type();}
 private:
   template <class J>
   bool satisfies_quantumnumbers(const std::vector<I>& idx,
@@ -107,6 +116,7 @@ private:
 
 
   basis_states_descriptor<I,SS> basis_descriptor_;
+  state_lookup<I> lookup_;
 };
 
 
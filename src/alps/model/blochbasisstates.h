@@ -49,27 +49,42 @@ public:
   bloch_basis_states() {}
   template <class J>
   bloch_basis_states(const basis_states_descriptor<I,SS>& b, const translation_type& t,
-              const std::vector<std::pair<std::string,half_integer<J> > >& c)
+              const std::vector<std::pair<std::string,half_integer<J> > >& c,
+              state_lookup_type lookup=binary_search_lookup)
     : basis_descriptor_(b)
-  { build(t,c);}
+  { 
+    build(t,c);
+    lookup_ = state_lookup<I>(lookup,basis_descriptor_,full_list_);
+  }
 
-  bloch_basis_states(const basis_states_descriptor<I,SS>& b, const translation_type& t)
+  bloch_basis_states(const basis_states_descriptor<I,SS>& b, const translation_type& t,
+              state_lookup_type lookup=binary_search_lookup)
     : basis_descriptor_(b)
   { 
     build(t,b.get_basis().constraints());
+    lookup_ = state_lookup<I>(lookup,basis_descriptor_,full_list_);
   }
                     
                 
   inline std::pair<std::size_t,std::complex<double> > index_and_phase(const value_type& x) const
   {
-    const_iterator it = std::lower_bound(full_list_.begin(), full_list_.end(), x);
-    if (it==full_list_.end() || *it != x)
-      return std::make_pair(size_type(super_type::size()),std::complex<double>(1.));
-    size_type idx = it-full_list_.begin();
+    size_type idx;
+    if (lookup_.type() != binary_search_lookup) {
+      idx = lookup_.find(x);
+      if (idx == full_list_.size())
+        return std::make_pair(size_type(super_type::size()),std::complex<double>(1.));
+    }
+    else {
+      const_iterator it = std::lower_bound(full_list_.begin(), full_list_.end(), x);
+      if (it==full_list_.end() || *it != x)
+        return std::make_pair(size_type(super_type::size()),std::complex<double>(1.));
+      idx = it-full_list_.begin();
+    }
     return std::make_pair(representative_[idx],phase_[idx]);
   }
 
   const basis_type& basis() const { return basis_descriptor_;}
+  state_lookup_type lookup_type() const { return lookup_.type();}
   
   double normalization(size_type i) const { return normalization_[i];}
   
@@ -91,6 +106,7 @@ private:
                     
 
   basis_states_descriptor<I,SS> basis_descriptor_;
+  state_lookup<I> lookup_;
   std::vector<S> full_list_;
   std::vector<std::size_t> representative_;
   std::vector<std::complex<double> > phase_;
@@ -0,0 +1,120 @@
+/*****************************************************************************
+*
+* ALPS Project: Algorithms and Libraries for Physics Simulations
+*
+* ALPS Libraries
+*
+* Copyright (C) 2003-2005 by Matthias Troyer <troyer@comp-phys.org>,
+*                            Synge Todo <wistaria@comp-phys.org>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+* 
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT 
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE 
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE, 
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+/* $Id$ */
+
+#ifndef ALPS_MODEL_COMPILED_EXPRESSION_CACHE_H
+#define ALPS_MODEL_COMPILED_EXPRESSION_CACHE_H
+
+#include <alps/expression.h>
+#include <alps/model/substitute.h>
+#include <boost/throw_exception.hpp>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace alps {
+
+// Compiles each (expression, type) pair once. The expression and the
+// parameters get every # replaced by the type, as for the terms of a model,
+// and all parameters are folded into the compiled expression. Symbols not
+// defined by the parameters, such as the coordinates x, y and z of a bond,
+// become slots of the compiled expression and are set at each evaluation.
+//
+// site_value and bond_value evaluate the coupling of one site or bond of a
+// graph_helper or csr_graph. The expression is compiled for the site or bond
+// type, and x, y and z are the coordinates of the site or of the bond center,
+// as set by coordinate_as_parameter for the interpreted evaluation.
+
+template <class T = std::complex<double> >
+class CompiledExpressionCache
+{
+public:
+  typedef expression::CompiledExpression<T> compiled_type;
+
+  CompiledExpressionCache(const Parameters& p) : parms_(p) {}
+
+  const compiled_type& operator()(const std::string& expression, unsigned int type);
+
+  template <class G>
+  T site_value(const std::string& expression, const G& graph, typename G::site_descriptor s)
+  {
+    const compiled_type& expr = (*this)(expression, graph.site_type(s));
+    T values[3];
+    for (std::size_t i = 0; i < expr.slots().size(); ++i)
+      values[i] = graph.coordinate(s, coordinate_index(expr.slots()[i], graph.dimension()));
+    return expr.value(values);
+  }
+
+  template <class G>
+  T bond_value(const std::string& expression, const G& graph, typename G::bond_descriptor b)
+  {
+    const compiled_type& expr = (*this)(expression, graph.bond_type(b));
+    T values[3];
+    for (std::size_t i = 0; i < expr.slots().size(); ++i) {
+      unsigned int c = coordinate_index(expr.slots()[i], graph.dimension());
+      values[i] = 0.5 * (graph.coordinate(graph.source(b), c) + graph.coordinate(graph.target(b), c));
+    }
+    return expr.value(values);
+  }
+
+  std::size_t size() const { return cache_.size(); }
+  void clear() { cache_.clear(); }
+
+private:
+  static unsigned int coordinate_index(const std::string& name, std::size_t dim)
+  {
+    unsigned int c = (name == "x" ? 0 : name == "y" ? 1 : name == "z" ? 2 : 3);
+    if (c >= dim)
+      boost::throw_exception(std::runtime_error("cannot evaluate " + name + " in a coupling"));
+    return c;
+  }
+
+  Parameters parms_;
+  std::map<std::pair<std::string, unsigned int>, compiled_type> cache_;
+};
+
+template <class T>
+const typename CompiledExpressionCache<T>::compiled_type&
+CompiledExpressionCache<T>::operator()(const std::string& expression, unsigned int type)
+{
+  std::pair<std::string, unsigned int> key(expression, type);
+  typename std::map<std::pair<std::string, unsigned int>, compiled_type>::iterator it = cache_.find(key);
+  if (it == cache_.end()) {
+    // random numbers are drawn at each evaluation, not while compiling
+    expression::ParameterEvaluator<T> eval(substitute(parms_, type), false);
+    it = cache_.insert(std::make_pair(key,
+           compiled_type(expression::Expression<T>(substitute(expression, type)), eval))).first;
+  }
+  return it->second;
+}
+
+} // namespace alps
+
+#endif
@@ -42,6 +42,7 @@
 
 #include <cmath>
 #include <cstddef>
+#include <utility>
 
 namespace alps {
 
@@ -95,8 +96,33 @@ public:
   typedef bloch_basis_states<short> bloch_basis_states_type;
   typedef basis_states_type::value_type state_type;
   
+  // the basis states of one set of parameters, see release_basis and adopt_basis
+  struct basis_type {
+    basis_states_descriptor<short> descriptor;
+    basis_states_type states;
+    bloch_basis_states_type bloch_states;
+  };
+
   hamiltonian_matrix (Parameters const& parms);
-  void set_parameters(Parameters const& p) { parms << p ; built_basis_=false; built_matrix_=false;}
+  void set_parameters(Parameters const& p) { parms << p ; built_basis_=false; built_matrix_=false; built_local_matrices_=false;}
+  // moves the basis of the current parameters into b, building it first if needed
+  void release_basis(basis_type& b)
+  {
+    if (!built_basis_)
+      build_basis();
+    swap_basis(b);
+    built_basis_=false;
+  }
+  // uses b, released by a hamiltonian_matrix of the same model and lattice with the
+  // current parameters, instead of building the basis again; b is left empty
+  void adopt_basis(basis_type& b)
+  {
+    swap_basis(b);
+    b = basis_type();
+    built_matrix_=false;
+    built_local_matrices_=false;
+    built_basis_=true;
+  }
   basis_states_type& states_vector() { if (!built_basis_) build_basis(); return states; }
   const basis_states_type& states_vector() const {if (!built_basis_) build_basis(); return states; }
   bloch_basis_states_type& bloch_states_vector() { if (!built_basis_) build_basis(); return bloch_states; }
@@ -117,6 +143,9 @@ public:
   template <class STATES, class V, class W>
   void apply_operator(const STATES&, const SiteOperator& op, site_descriptor s, const V&, W&) const;
 
+  template <class STATES, class V, class W>
+  void apply_operator(const STATES&, const boost::multi_array<value_type,2>& mat, site_descriptor s, const V&, W&) const;
+
   template <class V, class W> 
   void apply_operator(const SiteOperator& op, site_descriptor s, const V& x, W& y) const
   {
@@ -153,6 +182,11 @@ public:
   template <class V, class W> 
   void apply_operator(const GlobalOperator& op, const V&, W&) const;
 
+  // y += H x without building the matrix. The local site and bond matrices
+  // are calculated once and cached until the parameters change.
+  template <class V, class W> 
+  void apply_hamiltonian(const V& x, W& y) const;
+
   template <class MM, class OP> 
   MM operator_matrix(const OP& op) const 
   {
@@ -219,6 +253,13 @@ public:
 protected:
   void build() const;
   void build_basis() const;
+  void swap_basis(basis_type& b)
+  {
+    std::swap(basis_,b.descriptor);
+    std::swap(states,b.states);
+    std::swap(bloch_states,b.bloch_states);
+  }
+  void build_local_matrices() const;
 
   mutable basis_states_type states;
   mutable bloch_basis_states_type bloch_states;
@@ -227,7 +268,10 @@ private:
   Parameters parms;
   mutable bool built_matrix_;
   mutable bool built_basis_;
+  mutable bool built_local_matrices_;
   mutable matrix_type matrix_;
+  mutable std::vector<multi_array<value_type,2> > site_matrices_;
+  mutable std::vector<multi_array<std::pair<value_type,bool>,4> > bond_matrices_;
   mutable basis_states_descriptor<short> basis_;
   graph_helper<G> graph_;
   model_helper<> model_;
@@ -240,6 +284,7 @@ hamiltonian_matrix<M,G>::hamiltonian_matrix(Parameters const& p)
   : parms(p)
   ,  built_matrix_(false)
   ,  built_basis_(false)
+  ,  built_local_matrices_(false)
   ,  graph_(p)
   ,  model_(graph_,p,is_symbolic<value_type>::type::value)
 {}    
@@ -282,7 +327,12 @@ multi_array<std::pair<typename hamiltonian_matrix<M,G>::value_type,bool>,4> hami
 template <class M, class G> template <class STATES, class V, class W>
 void hamiltonian_matrix<M,G>::apply_operator(const STATES& states, const SiteOperator& op, site_descriptor s, const V& x, W& y) const
 {
-  multi_array<value_type,2> mat = local_matrix(op,s);
+  apply_operator(states,local_matrix(op,s),s,x,y);
+}
+
+template <class M, class G> template <class STATES, class V, class W>
+void hamiltonian_matrix<M,G>::apply_operator(const STATES& states, const boost::multi_array<value_type,2>& mat, site_descriptor s, const V& x, W& y) const
+{
   for (unsigned int i=0;i<dimension();++i) {           // loop basis states
     state_type state=states[i];               // get source state
     int is=state[s];                          // get site basis index
@@ -410,7 +460,41 @@ void hamiltonian_matrix<M,G>::apply_operator(const GlobalOperator& op, const V&
       apply_operator(op.bond_term(graph_.bond_type(*it)),*it,x,y);
 }
 
+template <class M, class G> template <class V, class W>
+void hamiltonian_matrix<M,G>::apply_hamiltonian(const V& x, W& y) const
+{
+  if (!built_local_matrices_)
+    build_local_matrices();
+
+  std::size_t i=0;
+  for (site_iterator it=graph_.sites().first; it!=graph_.sites().second ; ++it, ++i) {
+    if (uses_translation_invariance())
+      apply_operator(bloch_states,site_matrices_[i],*it,x,y);
+    else
+      apply_operator(states,site_matrices_[i],*it,x,y);
+  }
+
+  i=0;
+  for (bond_iterator it=graph_.bonds().first; it!=graph_.bonds().second ; ++it, ++i)
+    apply_operator(bond_matrices_[i],graph_.source(*it),graph_.target(*it),x,y);
+}
+
 
+template <class M, class G>
+void hamiltonian_matrix<M,G>::build_local_matrices() const
+{
+  if (!built_basis_)
+    build_basis();
+  Disorder::seed(parms.value_or_default("DISORDER_SEED",0));
+  const GlobalOperator& op = model_.model();
+  site_matrices_.clear();
+  for (site_iterator it=graph_.sites().first; it!=graph_.sites().second ; ++it)
+    site_matrices_.push_back(local_matrix(op.site_term(graph_.site_type(*it)),*it));
+  bond_matrices_.clear();
+  for (bond_iterator it=graph_.bonds().first; it!=graph_.bonds().second ; ++it) 
+    bond_matrices_.push_back(local_matrix(op.bond_term(graph_.bond_type(*it)),*it));
+  built_local_matrices_ = true;
+}
 
 
 template <class M, class G>
@@ -419,6 +503,7 @@ void hamiltonian_matrix<M,G>::build_basis() const
   basis_descriptor_type b = model_.basis();
   b.set_parameters(parms);
   basis_ = basis_states_descriptor<short>(b,graph_.graph());
+  state_lookup_type lookup = state_lookup_from_string(parms.value_or_default("STATE_LOOKUP","RANKING"));
   if (uses_translation_invariance()) {
     std::vector<Expression> k;
     read_vector_resize(parms["TOTAL_MOMENTUM"],k);
@@ -426,10 +511,10 @@ void hamiltonian_matrix<M,G>::build_basis() const
     vector_type total_momentum;
     for (unsigned i=0;i<k.size();++i)
       total_momentum.push_back(std::real(k[i].value(eval)));
-    bloch_states = bloch_basis_states_type(basis_,graph_.translations(total_momentum));
+    bloch_states = bloch_basis_states_type(basis_,graph_.translations(total_momentum),lookup);
   }
   else
-    states = basis_states_type(basis_);
+    states = basis_states_type(basis_,lookup);
   built_basis_ = true;
 }    
 
@@ -0,0 +1,200 @@
+/*****************************************************************************
+*
+* ALPS Project: Algorithms and Libraries for Physics Simulations
+*
+* ALPS Libraries
+*
+* Copyright (C) 2003-2013 by Matthias Troyer <troyer@comp-phys.org>,
+*                            Synge Todo <wistaria@comp-phys.org>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+*
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+/* $Id$ */
+
+#ifndef ALPS_MODEL_STATE_LOOKUP_H
+#define ALPS_MODEL_STATE_LOOKUP_H
+
+#include <boost/cstdint.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/unordered_map.hpp>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace alps {
+
+/// the strategies available to look up the index of a basis state
+enum state_lookup_type { binary_search_lookup, hash_lookup, ranking_lookup };
+
+inline state_lookup_type state_lookup_from_string(const std::string& name)
+{
+  if (name == "BINARY_SEARCH")
+    return binary_search_lookup;
+  else if (name == "HASH")
+    return hash_lookup;
+  else if (name == "RANKING")
+    return ranking_lookup;
+  boost::throw_exception(std::runtime_error("unknown state lookup " + name));
+  return binary_search_lookup;
+}
+
+/// \brief an index of a sorted list of basis states
+///
+/// The states are packed into 64-bit integers, using for each site just
+/// enough bits to store its site basis index. With the first site in the
+/// most significant bits the packed codes are sorted like the states.
+///
+/// hash_lookup stores the packed codes in a hash table. ranking_lookup
+/// splits each code into a high and a low part and uses two tables
+/// (Lin tables): the offset of the block of states sharing the high part,
+/// and the rank of the low part within its block. This works whenever the
+/// rank of the low part is the same in all blocks, as for states
+/// constrained by additive quantum numbers; otherwise the hash table is
+/// used instead. The hash table is also used if the Lin tables would have
+/// more than twice as many entries as there are states, as for small
+/// sectors of large lattices. If the states cannot be packed into 64 bits,
+/// type() returns binary_search_lookup and the caller keeps searching the
+/// states.
+template <class I>
+class state_lookup
+{
+public:
+  typedef boost::uint64_t code_type;
+  typedef std::size_t size_type;
+
+  state_lookup() : type_(binary_search_lookup), size_(0), low_bits_(0), low_mask_(0) {}
+
+  template <class B, class S>
+  state_lookup(state_lookup_type type, const B& basis, const std::vector<S>& states)
+    : type_(binary_search_lookup)
+    , size_(states.size())
+    , low_bits_(0)
+    , low_mask_(0)
+  {
+    if (type == binary_search_lookup)
+      return;
+    unsigned int total_bits = 0;
+    for (std::size_t i=0;i<basis.size();++i) {
+      unsigned int b = 0;
+      while ((std::size_t(1) << b) < basis[i].size())
+        ++b;
+      bits_.push_back(b);
+      total_bits += b;
+    }
+    if (total_bits > 64)
+      return;
+    if (type == ranking_lookup && build_ranking(states, total_bits))
+      type_ = ranking_lookup;
+    else {
+      hash_.rehash(states.size());
+      for (size_type i=0;i<states.size();++i)
+        hash_[encode(states[i])] = i;
+      type_ = hash_lookup;
+    }
+  }
+
+  state_lookup_type type() const { return type_;}
+
+  /// returns the index of a state, or the number of states if it is not found
+  template <class S>
+  size_type find(const S& x) const
+  {
+    code_type code = encode(x);
+    if (type_ == ranking_lookup) {
+      size_type r = rank_[code & low_mask_];
+      size_type o = offset_[code >> low_bits_];
+      if (r == invalid() || o == invalid() || o + r >= size_ || codes_[o+r] != code)
+        return size_;
+      return o + r;
+    }
+    typename boost::unordered_map<code_type,size_type>::const_iterator it = hash_.find(code);
+    return it == hash_.end() ? size_ : it->second;
+  }
+
+private:
+  static size_type invalid() { return std::numeric_limits<size_type>::max();}
+
+  template <class S>
+  code_type encode(const S& x) const
+  {
+    code_type code = 0;
+    for (std::size_t i=0;i<bits_.size();++i)
+      code = (code << bits_[i]) | static_cast<code_type>(x[i]);
+    return code;
+  }
+
+  template <class S>
+  bool build_ranking(const std::vector<S>& states, unsigned int total_bits)
+  {
+    // split the sites such that both halves need about the same number of bits
+    low_bits_ = 0;
+    for (std::size_t i=bits_.size(); i>0 && 2*(low_bits_+bits_[i-1]) <= total_bits; --i)
+      low_bits_ += bits_[i-1];
+    unsigned int high_bits = total_bits - low_bits_;
+    // the tables are indexed by the bit patterns, not the states: only use
+    // them if they are not much larger than the list of codes itself
+    if (low_bits_ > max_table_bits || high_bits > max_table_bits)
+      return false;
+    size_type table_size = (size_type(1) << high_bits) + (size_type(1) << low_bits_);
+    if (table_size > std::max(size_type(max_table_factor) * states.size(), size_type(min_table_size)))
+      return false;
+    low_mask_ = (code_type(1) << low_bits_) - 1;
+    offset_.assign(size_type(1) << high_bits, invalid());
+    rank_.assign(size_type(1) << low_bits_, invalid());
+    codes_.resize(states.size());
+    for (size_type i=0;i<states.size();++i) {
+      code_type code = encode(states[i]);
+      codes_[i] = code;
+      size_type& o = offset_[code >> low_bits_];
+      if (o == invalid())
+        o = i;
+      size_type& r = rank_[code & low_mask_];
+      if (r == invalid())
+        r = i - o;
+      else if (r != i - o) {
+        std::vector<size_type>().swap(offset_);
+        std::vector<size_type>().swap(rank_);
+        std::vector<code_type>().swap(codes_);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  BOOST_STATIC_CONSTANT(unsigned int, max_table_bits = 24);
+  BOOST_STATIC_CONSTANT(unsigned int, max_table_factor = 2);
+  BOOST_STATIC_CONSTANT(unsigned int, min_table_size = 1024);
+
+  state_lookup_type type_;
+  size_type size_;
+  std::vector<unsigned int> bits_;
+  boost::unordered_map<code_type,size_type> hash_;
+  unsigned int low_bits_;
+  code_type low_mask_;
+  std::vector<size_type> offset_;
+  std::vector<size_type> rank_;
+  std::vector<code_type> codes_;
+};
+
+} // namespace alps
+
+#endif
@@ -37,6 +37,7 @@
 #include <boost/cstdint.hpp>
 #include <cstdio>
 #include <string>
+#include <vector>
 #include <stdio.h>
 
 #ifdef ALPS_HAVE_RPC_XDR_H
@@ -196,6 +197,37 @@ private:
   void open_file(const std::string&);
 };
 
+/** a dump for serializing objects into a byte buffer using the XDR format.
+    The stream is staged in an anonymous temporary file, since the stdio
+    XDR streams are the only ones available on all platforms. */
+
+class ALPS_DECL OXDRBufferDump: public OXDRDump
+{
+public:
+  OXDRBufferDump();
+  virtual ~OXDRBufferDump();
+
+  /** the bytes written to the dump so far */
+  std::vector<char> buffer();
+
+private:
+  std::FILE* file_;
+};
+
+
+/** a dump for deserializing objects from a byte buffer written by an
+    OXDRBufferDump. */
+
+class ALPS_DECL IXDRBufferDump: public IXDRDump
+{
+public:
+  IXDRBufferDump(const std::vector<char>& buffer);
+  virtual ~IXDRBufferDump();
+
+private:
+  std::FILE* file_;
+};
+
 } // end namespace alps
 
 #endif // OSIRIS_XDRDUMP_H
@@ -0,0 +1,80 @@
+/*****************************************************************************
+*
+* ALPS Project: Algorithms and Libraries for Physics Simulations
+*
+* ALPS Libraries
+*
+* Copyright (C) 1997-2014 by Synge Todo <wistaria@comp-phys.org>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+* 
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT 
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE 
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE, 
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+#ifndef PARAPACK_CHECKPOINT_WRITER_H
+#define PARAPACK_CHECKPOINT_WRITER_H
+
+#include <alps/ngs/config.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <deque>
+#include <map>
+#include <string>
+
+#ifndef ALPS_NGS_SINGLE_THREAD
+# include <boost/thread.hpp>
+#endif
+
+namespace alps {
+namespace parapack {
+
+// Writes checkpoints in a background thread, so that the clones can continue
+// working while their snapshots are written to disk.  Each job is identified
+// by the file it writes.  A job replaces a pending job for the same file,
+// such that a slow disk never accumulates outdated checkpoints.
+
+class checkpoint_writer : private boost::noncopyable {
+public:
+  typedef boost::function<void()> job_t;
+
+  checkpoint_writer();
+  ~checkpoint_writer(); // finishes all pending jobs
+
+  void push(std::string const& file, job_t const& job);
+
+  // wait until no job for the file is pending or being written
+  void wait(std::string const& file);
+  void wait_all();
+
+private:
+  void run();
+
+  std::deque<std::string> order_;
+  std::map<std::string, job_t> pending_;
+  std::string current_;
+  bool stop_;
+#ifndef ALPS_NGS_SINGLE_THREAD
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  boost::thread thread_;
+#endif
+};
+
+} // end namespace parapack
+} // end namespace alps
+
+#endif // PARAPACK_CHECKPOINT_WRITER_H
@@ -28,6 +28,7 @@
 #ifndef PARAPACK_CLONE_H
 #define PARAPACK_CLONE_H
 
+#include "checkpoint_writer.h"
 #include "clone_info.h"
 #include "clone_timer.h"
 #include "option.h"
@@ -75,7 +76,8 @@ public:
 class clone : public abstract_clone {
 public:
   clone(boost::filesystem::path const& basedir, alps::parapack::option opt, tid_t tid, cid_t cid,
-    Parameters const& params, std::string const& base, bool is_new);
+    Parameters const& params, std::string const& base, bool is_new,
+    parapack::checkpoint_writer* writer = 0);
   virtual ~clone();
 
   tid_t task_id() const { return task_id_; }
@@ -99,6 +101,9 @@ protected:
   void do_halt();
 
 private:
+  // hand a copy of the current state to the checkpoint writer
+  void save_snapshot();
+
   tid_t task_id_;
   cid_t clone_id_;
 
@@ -114,6 +119,7 @@ private:
   clone_timer::loops_t loops_;
 
   boost::shared_ptr<parapack::abstract_worker> worker_;
+  parapack::checkpoint_writer* writer_;
 };
 
 #ifdef ALPS_HAVE_MPI
@@ -34,12 +34,13 @@ namespace alps {
 
 class clone_proxy {
 public:
-  clone_proxy(clone*& clone_ptr, boost::filesystem::path const& basedir, alps::parapack::option opt)
-    : clone_ptr_(clone_ptr), basedir_(basedir), opt_(opt) {}
+  clone_proxy(clone*& clone_ptr, boost::filesystem::path const& basedir, alps::parapack::option opt,
+    parapack::checkpoint_writer* writer = 0)
+    : clone_ptr_(clone_ptr), basedir_(basedir), opt_(opt), writer_(writer) {}
   bool is_local(Process const&) const { return true; }
   void start(tid_t tid, cid_t cid, thread_group const&, Parameters const& params,
     std::string const& base, bool is_new) {
-    clone_ptr_ = new clone(basedir_, opt_, tid, cid, params, base, is_new);
+    clone_ptr_ = new clone(basedir_, opt_, tid, cid, params, base, is_new, writer_);
   }
   clone_info const& info(Process const&) const {
     if (!clone_ptr_)
@@ -60,6 +61,7 @@ private:
   clone*& clone_ptr_;
   boost::filesystem::path basedir_;
   alps::parapack::option opt_;
+  parapack::checkpoint_writer* writer_;
 };
 
 #ifdef ALPS_HAVE_MPI
@@ -43,6 +43,7 @@
 #include <algorithm>
 #include <functional>
 #include <cmath>
+#include <stdexcept>
 #include <vector>
 
 namespace alps {
@@ -1259,6 +1260,465 @@ private:
   std::vector<int> permutation_;          // [master only]
 };
 
+//
+// distributed_exchange_worker
+//
+// Same alternating exchange as parallel_exchange_worker, but without the
+// master process and without any collective communication in the exchange
+// steps.  Each process knows only the temperature id and the label of its
+// own walkers, and for each of them the processes holding the walkers at
+// the neighboring temperatures.  An exchange between two processes takes
+// one weight parameter sent to the process with the walker at the higher
+// inverse temperature, which decides the exchange and sends the decision
+// back.  After an accepted exchange, the processes at the ends of the pair
+// are told the new holder of the temperature next to theirs: the
+// neighboring processes across each boundary between two pairs tell each
+// other the new holders of their temperatures, and a process whose walker
+// moved passes the answer on to its partner, which now holds its
+// temperature.  The statistics of the walker labels are kept by the
+// process holding the temperature and summed over the processes once at
+// the end of each optimization stage.  Random exchange and the rate
+// optimization are not supported.
+//
+
+template<typename WALKER, typename INITIALIZER = exmc::no_initializer>
+class distributed_exchange_worker : public mc_worker {
+private:
+  typedef mc_worker super_type;
+  typedef WALKER walker_type;
+  typedef typename walker_type::weight_parameter_type weight_parameter_type;
+  typedef INITIALIZER initializer_type;
+  typedef exmc::initializer_helper<walker_type, initializer_type> helper;
+  typedef exmc::walker_direc walker_direc;
+
+  // message tags of the four phases of an exchange step
+  enum { tag_weight, tag_decision, tag_boundary, tag_relay, num_tags };
+
+public:
+  static std::string version() { return walker_type::version(); }
+  static void print_copyright(std::ostream& out) { walker_type::print_copyright(out); }
+
+  distributed_exchange_worker(boost::mpi::communicator const& comm, alps::Parameters const& params)
+    : super_type(params), comm_(comm), init_(params), beta_(params), mcs_(params),
+      num_returnee_(0) {
+
+    int nrep = beta_.size();
+    if (mcs_.exchange() && mcs_.random_exchange())
+      boost::throw_exception(std::invalid_argument(
+        "distributed_exchange_worker supports alternating exchange only"));
+    if (mcs_.exchange() && mcs_.perform_optimization() &&
+        mcs_.optimization_type() == exmc::exchange_steps::rate)
+      boost::throw_exception(std::invalid_argument(
+        "distributed_exchange_worker supports population optimization only"));
+
+    std::vector<int> nreps(comm_.size()), offsets(comm_.size());
+    for (int p = 0; p < comm_.size(); ++p) boost::tie(nreps[p], offsets[p]) = calc_nrep(p);
+    nrep_local_ = nreps[comm_.rank()];
+    offset_local_ = offsets[comm_.rank()];
+    if (nrep_local_ == 0) {
+      std::cerr << "Error: number of replicas is smaller than number of processes\n";
+      boost::throw_exception(std::runtime_error(
+        "number of replicas is smaller than number of processes"));
+    }
+    if (comm_.rank() == 0) {
+      std::cout << "EXMC: number of replicas = " << nrep << std::endl
+                << "EXMC: number of replicas on each process = "
+                << write_vector(nreps) << std::endl
+                << "EXMC: initial inverse temperature set = "
+                << write_vector(beta_, " ", 5) << std::endl;
+    }
+
+    // initialize walkers
+    walker_.resize(nrep_local_);
+    alps::Parameters wp(params);
+    for (int p = 0; p < nrep_local_; ++p) {
+      // different WORKER_SEED for each walker, same DISORDER_SEED for all walkers
+      for (int j = 1; j < 3637 /* 509th prime number */; ++j) engine()();
+      wp["WORKER_SEED"] = engine()();
+      walker_[p] = helper::create_walker(wp, init_);
+    }
+
+    // the w-th walker on process q starts at temperature offsets[q] + w
+    std::vector<int> owner(nrep);
+    for (int q = 0; q < comm_.size(); ++q)
+      for (int p = offsets[q]; p < offsets[q] + nreps[q]; ++p) owner[p] = q;
+    tid_.resize(nrep_local_);
+    below_.resize(nrep_local_);
+    above_.resize(nrep_local_);
+    for (int w = 0; w < nrep_local_; ++w) {
+      int p = w + offset_local_;
+      tid_[w] = p;
+      below_[w] = (p > 0) ? owner[p-1] : -1;
+      above_[w] = (p < nrep - 1) ? owner[p+1] : -1;
+    }
+    init_local_walkers();
+
+    // initialize walker labels and working space
+    if (mcs_.exchange()) {
+      direc_.resize(nrep_local_);
+      for (int w = 0; w < nrep_local_; ++w)
+        direc_[w] = (w + offset_local_ == 0) ? walker_direc::down : walker_direc::unlabeled;
+      num_up_.resize(nrep, 0);
+      num_down_.resize(nrep, 0);
+      num_accept_.resize(nrep - 1, 0);
+      num_trial_.resize(nrep - 1, 0);
+      wp_local_.resize(nrep_local_);
+      wp_remote_.resize(nrep_local_);
+      accepted_.resize(nrep_local_);
+      holder_.resize(nrep_local_);
+      outer_.resize(nrep_local_);
+      relay_.resize(nrep_local_);
+      upward_.resize(nrep);
+      accept_.resize(nrep - 1);
+    }
+  }
+  virtual ~distributed_exchange_worker() {}
+
+  void init_observables(alps::Parameters const& params, std::vector<alps::ObservableSet>& obs) {
+    int nrep = beta_.size();
+    obs.resize(nrep);
+    for (int p = 0; p < nrep; ++p)
+      helper::init_observables(walker_[0], params, init_, obs[p]);
+    // the label observables are measured by the process holding the temperature (or the
+    // walker) and merged over the processes like the observables of the walkers
+    for (int p = 0; p < nrep; ++p) {
+      if (comm_.rank() == 0)
+        obs[p] << SimpleRealObservable("EXMC: Temperature")
+               << SimpleRealObservable("EXMC: Inverse Temperature");
+      if (mcs_.exchange()) {
+        obs[p] << SimpleRealObservable("EXMC: Ratio of Upward-Moving Walker")
+               << SimpleRealObservable("EXMC: Ratio of Downward-Moving Walker")
+               << SimpleRealObservable("EXMC: Inverse Round-Trip Time");
+        obs[p]["EXMC: Ratio of Upward-Moving Walker"].reset(true);
+        obs[p]["EXMC: Ratio of Downward-Moving Walker"].reset(true);
+        if (p != nrep - 1) {
+          obs[p] << SimpleRealObservable("EXMC: Acceptance Rate");
+          obs[p]["EXMC: Acceptance Rate"].reset(true);
+        }
+      }
+    }
+    if (mcs_.exchange()) obs[0] << SimpleRealObservable("EXMC: Average Inverse Round-Trip Time");
+  }
+
+  void run(std::vector<alps::ObservableSet>& obs) {
+    ++mcs_;
+
+    int nrep = beta_.size();
+    int rank = comm_.rank();
+
+    if (comm_.rank() == 0) {
+      for (int p = 0; p < nrep; ++p) {
+        add_constant(obs[p]["EXMC: Temperature"], 1. / beta_[p]);
+        add_constant(obs[p]["EXMC: Inverse Temperature"], beta_[p]);
+      }
+    }
+
+    // MC update of each replica
+    for (int w = 0; w < nrep_local_; ++w) {
+      int p = tid_[w];
+      walker_[w]->set_beta(beta_[p]);
+      helper::run_walker(walker_[w], init_, obs[p]);
+    }
+
+    // replica exchange process
+    if (mcs_.exchange() && (mcs_() % mcs_.interval()) == 0) {
+      int start = (mcs_() / mcs_.interval()) % 2;
+      std::vector<boost::mpi::request> requests;
+
+      // send the weight parameter of the walker at the lower inverse temperature of each pair
+      // to the process deciding the exchange
+      for (int w = 0; w < nrep_local_; ++w) wp_local_[w] = walker_[w]->weight_parameter();
+      for (int w = 0; w < nrep_local_; ++w) {
+        int p = tid_[w];
+        if (is_lower(p, start) && above_[w] != rank)
+          requests.push_back(comm_.isend(above_[w], tag(p, tag_weight), wp_local_[w]));
+        if (is_upper(p, start) && below_[w] != rank)
+          requests.push_back(comm_.irecv(below_[w], tag(p-1, tag_weight), wp_remote_[w]));
+      }
+      boost::mpi::wait_all(requests.begin(), requests.end());
+      requests.clear();
+
+      // decide the exchanges for which this process holds the walker at the higher inverse
+      // temperature, and send the decisions back
+      std::fill(accepted_.begin(), accepted_.end(), 0);
+      for (int w1 = 0; w1 < nrep_local_; ++w1) {
+        int p = tid_[w1] - 1;
+        if (!is_upper(p + 1, start)) continue;
+        weight_parameter_type const& wp0 = (below_[w1] == rank) ?
+          wp_local_[local_[p]] : wp_remote_[w1];
+        weight_parameter_type const& wp1 = wp_local_[w1];
+        double logp = ((walker_type::log_weight(wp1, beta_[p]  ) +
+                        walker_type::log_weight(wp0, beta_[p+1])) -
+                       (walker_type::log_weight(wp1, beta_[p+1]) +
+                        walker_type::log_weight(wp0, beta_[p]  )));
+        if (logp > 0 || uniform_01() < std::exp(logp)) {
+          accepted_[w1] = 1;
+          ++num_accept_[p];
+        }
+        ++num_trial_[p];
+        obs[p]["EXMC: Acceptance Rate"] << (accepted_[w1] ? 1. : 0.);
+        if (below_[w1] == rank)
+          accepted_[local_[p]] = accepted_[w1];
+        else
+          requests.push_back(comm_.isend(below_[w1], tag(p, tag_decision), accepted_[w1]));
+      }
+      for (int w0 = 0; w0 < nrep_local_; ++w0) {
+        int p = tid_[w0];
+        if (is_lower(p, start) && above_[w0] != rank)
+          requests.push_back(comm_.irecv(above_[w0], tag(p, tag_decision), accepted_[w0]));
+      }
+      boost::mpi::wait_all(requests.begin(), requests.end());
+      requests.clear();
+
+      // the process holding the temperature of each walker after the exchange
+      for (int w = 0; w < nrep_local_; ++w) {
+        int p = tid_[w];
+        holder_[w] = rank;
+        if (accepted_[w]) holder_[w] = is_lower(p, start) ? above_[w] : below_[w];
+      }
+
+      // across each boundary between two pairs, tell the neighbor the new holder of the
+      // temperature; the walker at the outer end of a pair has at most one such neighbor
+      for (int w = 0; w < nrep_local_; ++w) {
+        int p = tid_[w];
+        outer_[w] = -1;
+        if (!is_upper(p, start) && p > 0) {
+          if (below_[w] == rank)
+            outer_[w] = holder_[local_[p-1]];
+          else {
+            requests.push_back(comm_.isend(below_[w], tag(p-1, tag_boundary), holder_[w]));
+            requests.push_back(comm_.irecv(below_[w], tag(p-1, tag_boundary), outer_[w]));
+          }
+        }
+        if (!is_lower(p, start) && p < nrep - 1) {
+          if (above_[w] == rank)
+            outer_[w] = holder_[local_[p+1]];
+          else {
+            requests.push_back(comm_.isend(above_[w], tag(p, tag_boundary), holder_[w]));
+            requests.push_back(comm_.irecv(above_[w], tag(p, tag_boundary), outer_[w]));
+          }
+        }
+      }
+      boost::mpi::wait_all(requests.begin(), requests.end());
+      requests.clear();
+
+      // the partners of an exchange between two processes swap what they were told, since
+      // each of them now holds the temperature of the other
+      for (int w = 0; w < nrep_local_; ++w) {
+        int p = tid_[w];
+        relay_[w] = outer_[w];
+        if (!accepted_[w]) continue;
+        int partner = is_lower(p, start) ? above_[w] : below_[w];
+        if (partner == rank)
+          relay_[w] = outer_[local_[is_lower(p, start) ? p+1 : p-1]];
+        else {
+          requests.push_back(comm_.isend(partner, tag(p, tag_relay), outer_[w]));
+          requests.push_back(comm_.irecv(partner, tag(is_lower(p, start) ? p+1 : p-1, tag_relay),
+                                         relay_[w]));
+        }
+      }
+      boost::mpi::wait_all(requests.begin(), requests.end());
+      requests.clear();
+
+      // move the walkers and update the processes at the neighboring temperatures
+      for (int w = 0; w < nrep_local_; ++w) {
+        int p = tid_[w];
+        bool lower = is_lower(p, start);
+        bool upper = is_upper(p, start);
+        if (accepted_[w]) {
+          // the walker moves to the temperature of its partner, which now holds p
+          if (lower) {
+            tid_[w] = p + 1;
+            below_[w] = holder_[w];
+            above_[w] = relay_[w];
+          } else {
+            tid_[w] = p - 1;
+            above_[w] = holder_[w];
+            below_[w] = relay_[w];
+          }
+        } else {
+          // only the process across the boundary may have changed
+          if (!upper && p > 0) below_[w] = relay_[w];
+          if (!lower && p < nrep - 1) above_[w] = relay_[w];
+        }
+      }
+      init_local_walkers();
+
+      // update the walker labels
+      for (int w = 0; w < nrep_local_; ++w) {
+        int p = tid_[w];
+        bool returned = (p == 0 && direc_[w] == walker_direc::up);
+        obs[w + offset_local_]["EXMC: Inverse Round-Trip Time"] << (returned ? 1. : 0.);
+        if (p == 0) {
+          obs[0]["EXMC: Average Inverse Round-Trip Time"] << (returned ? 1. / nrep : 0.);
+          if (returned) ++num_returnee_;
+          direc_[w] = walker_direc::down;
+        }
+        if (p == nrep - 1 && direc_[w] == walker_direc::down) direc_[w] = walker_direc::up;
+        if (direc_[w] == walker_direc::up) ++num_up_[p];
+        if (direc_[w] == walker_direc::down) ++num_down_[p];
+        obs[p]["EXMC: Ratio of Upward-Moving Walker"] <<
+          (direc_[w] == walker_direc::up ? 1. : 0.);
+        obs[p]["EXMC: Ratio of Downward-Moving Walker"] <<
+          (direc_[w] == walker_direc::down ? 1. : 0.);
+      }
+
+      if (mcs_.doing_optimization() && mcs_.stage_count() == mcs_.stage_sweeps()) {
+
+        // sum the statistics of this stage over the processes
+        std::vector<int> local(2 * nrep + 2 * (nrep - 1) + 2, 0), total(local.size());
+        std::copy(num_up_.begin(), num_up_.end(), local.begin());
+        std::copy(num_down_.begin(), num_down_.end(), local.begin() + nrep);
+        std::copy(num_accept_.begin(), num_accept_.end(), local.begin() + 2 * nrep);
+        std::copy(num_trial_.begin(), num_trial_.end(), local.begin() + 3 * nrep - 1);
+        local[local.size() - 2] = num_returnee_;
+        for (int w = 0; w < nrep_local_; ++w)
+          if (direc_[w] == walker_direc::unlabeled) ++local[local.size() - 1];
+        all_reduce(comm_, &local[0], local.size(), &total[0], std::plus<int>());
+        int returnee = total[total.size() - 2];
+        int nu = total[total.size() - 1];
+
+        bool success = (returnee >= nrep);
+        if (nu > 0) success = false;
+
+        for (int p = 0; p < nrep; ++p) {
+          double n = total[p] + total[nrep + p];
+          upward_[p] = (n > 0) ? total[p] / n : alps::nan();
+        }
+        for (int p = 0; p < nrep - 1; ++p) {
+          int trial = total[3 * nrep - 1 + p];
+          accept_[p] = (trial > 0) ? double(total[2 * nrep + p]) / trial : 0;
+        }
+
+        if (comm_.rank() == 0)
+          std::cout << "EXMC stage " << mcs_.stage()
+                    << ": stage count = " << mcs_.stage_count() << '\n'
+                    << "EXMC stage " << mcs_.stage()
+                    << ": number of returned walkers = " << returnee << '\n'
+                    << "EXMC stage " << mcs_.stage()
+                    << ": number of unlabeled walkers = " << nu << '\n'
+                    << "EXMC stage " << mcs_.stage()
+                    << ": population ratio of upward-moving walkers "
+                    << write_vector(upward_, " ", 5) << '\n'
+                    << "EXMC stage " << mcs_.stage()
+                    << ": acceptance rate " << write_vector(accept_, " ", 3) << std::endl;
+
+        // preform optimization (identical on all the processes)
+        if (mcs_.stage() != 0 && success) success = beta_.optimize2(upward_);
+
+        if (success) {
+          if (comm_.rank() == 0) {
+            std::cout << "EXMC stage " << mcs_.stage() << ": DONE" << std::endl;
+            if (mcs_.stage() > 0)
+              std::cout << "EXMC stage " << mcs_.stage() << ": optimized inverse temperature set = "
+                        << write_vector(beta_, " ", 5) << std::endl;
+          }
+          for (int p = 0; p < nrep - 1; ++p) {
+            obs[p]["EXMC: Acceptance Rate"].reset(true);
+          }
+          for (int p = 0; p < nrep; ++p) {
+            obs[p]["EXMC: Ratio of Upward-Moving Walker"].reset(true);
+            obs[p]["EXMC: Ratio of Downward-Moving Walker"].reset(true);
+          }
+          mcs_.next_stage();
+          std::fill(num_up_.begin(), num_up_.end(), 0);
+          std::fill(num_down_.begin(), num_down_.end(), 0);
+          std::fill(num_accept_.begin(), num_accept_.end(), 0);
+          std::fill(num_trial_.begin(), num_trial_.end(), 0);
+          num_returnee_ = 0;
+        } else {
+          // increase stage sweeps
+          mcs_.continue_stage();
+          if (comm_.rank() == 0)
+            std::cout << "EXMC stage " << mcs_.stage() << ": NOT FINISHED\n"
+                      << "EXMC stage " << mcs_.stage() << ": increased number of sweeps to "
+                      << mcs_.stage_sweeps() << std::endl;
+        }
+      }
+    }
+  }
+
+  void save(alps::ODump& dp) const {
+    dp << beta_ << mcs_ << tid_ << below_ << above_ << direc_ << num_returnee_
+       << num_up_ << num_down_ << num_accept_ << num_trial_;
+    for (int i = 0; i < nrep_local_; ++i) walker_[i]->save(dp);
+  }
+  void load(alps::IDump& dp) {
+    dp >> beta_ >> mcs_ >> tid_ >> below_ >> above_ >> direc_ >> num_returnee_
+       >> num_up_ >> num_down_ >> num_accept_ >> num_trial_;
+    for (int i = 0; i < nrep_local_; ++i) walker_[i]->load(dp);
+    init_local_walkers();
+  }
+
+  bool is_thermalized() const { return mcs_.is_thermalized(); }
+  double progress() const { return mcs_.progress(); }
+
+  static void evaluate_observable(alps::ObservableSet& obs) {
+    walker_type::evaluate_observable(obs);
+  }
+
+protected:
+  std::pair<int, int> calc_nrep(int id) const {
+    int nrep = beta_.size();
+    int n = nrep / comm_.size();
+    int f;
+    if (id < nrep - n * comm_.size()) {
+      ++n;
+      f = n * id;
+    } else {
+      f = (nrep - n * comm_.size()) + n * id;
+    }
+    return std::make_pair(n, f);
+  }
+
+  // the walker at temperature p is the lower (upper) one of a pair in the step starting at
+  // pair start, or neither of them
+  bool is_lower(int p, int start) const {
+    return (p - start) % 2 == 0 && p >= start && p < static_cast<int>(beta_.size()) - 1;
+  }
+  bool is_upper(int p, int start) const { return p > 0 && is_lower(p - 1, start); }
+
+  // message tag of a pair (or of a boundary) of temperatures p and p+1 in a phase
+  int tag(int p, int phase) const { return num_tags * p + phase; }
+
+  void init_local_walkers() {
+    local_.assign(beta_.size(), -1);
+    for (int w = 0; w < nrep_local_; ++w) local_[tid_[w]] = w;
+  }
+
+private:
+  boost::mpi::communicator comm_;
+
+  int nrep_local_;           // number of walkers (replicas) on this process
+  int offset_local_;         // first (global) id of walker on this process
+
+  initializer_type init_;
+  std::vector<boost::shared_ptr<walker_type> > walker_; // [0..nrep_local_)
+
+  exmc::inverse_temperature_set beta_;
+  exmc::exchange_steps mcs_;
+  std::vector<int> tid_;        // temperature id of each local walker
+  std::vector<int> below_;      // process holding the temperature below that of each local walker
+  std::vector<int> above_;      // process holding the temperature above that of each local walker
+  std::vector<int> local_;      // local walker at each temperature, or -1
+  std::vector<int> direc_;      // direction of each local walker
+  int num_returnee_;            // number of walkers returned to highest temperature on this process
+  std::vector<int> num_up_;     // number of upward-moving walkers seen at each temperature
+  std::vector<int> num_down_;   // number of downward-moving walkers seen at each temperature
+  std::vector<int> num_accept_; // number of exchanges accepted by this process for each pair
+  std::vector<int> num_trial_;  // number of exchanges decided by this process for each pair
+
+  // working space
+  std::vector<weight_parameter_type> wp_local_;
+  std::vector<weight_parameter_type> wp_remote_;
+  std::vector<int> accepted_;   // exchange of each local walker accepted
+  std::vector<int> holder_;     // process holding the temperature of each local walker after the exchange
+  std::vector<int> outer_;      // new holder of the temperature across the boundary of each local walker
+  std::vector<int> relay_;      // new holder of the temperature across the boundary after the move
+  std::vector<double> upward_;
+  std::vector<double> accept_;
+};
+
 #endif // ALPS_HAVE_MPI
 
 } // end namespace parapack
@@ -49,6 +49,7 @@ struct option {
   dump_policy_t dump_policy;
   task_range_t task_range;
   bool write_xml;
+  bool async_checkpoint;
   bool use_mpi, default_total_threads, auto_total_threads;
   int num_total_threads, threads_per_clone;
   std::vector<std::string> jobfiles;
@@ -33,9 +33,16 @@
 #define PARAPACK_QUEUE_H
 
 #include "job.h"
+#include <alps/ngs/config.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
 #include <queue>
 
+#ifndef ALPS_NGS_SINGLE_THREAD
+# include <boost/thread/mutex.hpp>
+#endif
+
 namespace alps {
 
 //
@@ -55,6 +62,88 @@ bool operator<(task_queue_element_t const& lhs, task_queue_element_t const& rhs)
 typedef std::priority_queue<task_queue_element_t> task_queue_t;
 
 
+//
+// task_dispatcher
+//
+
+// Task queues of the thread groups.  A group takes the task with the largest
+// weight from its own queue and steals from the other queues once its own
+// queue is empty.  Each queue has its own lock, so that thread groups only
+// contend when they access the same queue.
+
+class ALPS_DECL task_dispatcher : private boost::noncopyable {
+public:
+  explicit task_dispatcher(int num_groups);
+
+  int num_groups() const { return num_groups_; }
+
+  // distribute tasks round robin over the queues
+  void push(task_queue_element_t const& t);
+  void push(gid_t gid, task_queue_element_t const& t);
+
+  // returns false if all queues are empty
+  bool pop(gid_t gid, task_queue_element_t& t);
+
+private:
+  struct queue_type {
+    task_queue_t tasks;
+#ifndef ALPS_NGS_SINGLE_THREAD
+    boost::mutex mutex;
+#endif
+  };
+  bool pop_from(queue_type& q, task_queue_element_t& t);
+
+  int num_groups_;
+  int next_;
+  boost::scoped_array<queue_type> queues_;
+};
+
+
+//
+// task_locks
+//
+
+// One lock per task.  The scheduler holds the lock of a task while it
+// dispatches, halts, suspends, checkpoints or reports one of its clones, so
+// that thread groups working on different tasks do not wait for each other.
+// Code that needs a consistent view of all tasks, such as writing the master
+// file, takes all locks in the order of the task indices.
+
+class ALPS_DECL task_locks : private boost::noncopyable {
+public:
+  explicit task_locks(std::size_t num_tasks);
+
+  std::size_t size() const { return size_; }
+  void lock(tid_t tid);
+  void unlock(tid_t tid);
+  void lock_all();
+  void unlock_all();
+
+  class scoped_lock : private boost::noncopyable {
+  public:
+    scoped_lock(task_locks& locks, tid_t tid) : locks_(locks), tid_(tid) { locks_.lock(tid_); }
+    ~scoped_lock() { locks_.unlock(tid_); }
+  private:
+    task_locks& locks_;
+    tid_t tid_;
+  };
+
+  class scoped_lock_all : private boost::noncopyable {
+  public:
+    explicit scoped_lock_all(task_locks& locks) : locks_(locks) { locks_.lock_all(); }
+    ~scoped_lock_all() { locks_.unlock_all(); }
+  private:
+    task_locks& locks_;
+  };
+
+private:
+  std::size_t size_;
+#ifndef ALPS_NGS_SINGLE_THREAD
+  boost::scoped_array<boost::mutex> mutex_;
+#endif
+};
+
+
 //
 // check_queue
 //
@@ -55,6 +55,11 @@ public:
   double random_01(int r) { return generators_[r]->operator()(); }
   double uniform_01() { return random_01(); }
   double uniform_01(int r) { return random_01(r); }
+  // same numbers as n calls of uniform_01(), converted in bulk
+  void generate_uniform_01(double* first, std::size_t n) { engines_[0]->generate_uniform_01(first, n); }
+  void generate_uniform_01(int r, double* first, std::size_t n) {
+    engines_[r]->generate_uniform_01(first, n);
+  }
   // int random_int(int a, int b) { return a + int((b-a+1) * rngs[0]()); }
   // int random_int(int n) { return int(n * uniform_01()); }
   // double random() { return uniform_01(); } // obsolete
@@ -40,6 +40,7 @@
 #include <alps/random/pseudo_des.h>
 #include <alps/random/seed.h>
 #include <alps/random/mersenne_twister.hpp>
+#include <alps/random/philox.h>
 
 #include <boost/integer_traits.hpp>
 #include <boost/utility.hpp>
@@ -48,11 +49,23 @@
 #include <boost/generator_iterator.hpp>
 #include <boost/detail/workaround.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
 namespace alps {
 
+/// \brief fills a range with numbers from a generator
+///
+/// calls the generator once for each number. Generators which can produce
+/// a whole block at once provide an overload of this function.
+template <class RNG>
+void generate_block(RNG& rng, uint32_t* first, uint32_t* last)
+{
+  for (; first != last; ++first)
+    *first = rng();
+}
+
 /// \brief abstract base class of a runtime-polymorphic random number generator
 ///
 /// In order to mask the abstraction penalty, the derived generators
@@ -93,9 +106,17 @@ public:
     return *ptr_++;
   }
 
+  /// copies the next n random numbers to the output iterator
   template <class OutputIterator>
   OutputIterator generate_n(std::size_t n, OutputIterator it);
 
+  /// \brief fills [out, out+n) with random numbers uniformly distributed in [0,1)
+  ///
+  /// gives the same numbers as drawing them one by one through
+  /// boost::uniform_real<double>(0,1), but converts whole runs of the
+  /// buffer in a single loop
+  void generate_uniform_01(double* out, std::size_t n);
+
   /// seed with an unsigned integer
   virtual void seed(uint32_t) = 0;
   /// seed with the default value
@@ -124,6 +145,41 @@ private:
   virtual void fill_buffer() = 0;
 };
 
+template <class OutputIterator>
+OutputIterator buffered_rng_base::generate_n(std::size_t n, OutputIterator it)
+{
+  while (n) {
+    if(ptr_==buf_.end()) {
+      fill_buffer();
+      ptr_=buf_.begin();
+    }
+    std::size_t k = std::min<std::size_t>(n, buf_.end()-ptr_);
+    it = std::copy(ptr_, ptr_+k, it);
+    ptr_ += k;
+    n -= k;
+  }
+  return it;
+}
+
+inline void buffered_rng_base::generate_uniform_01(double* out, std::size_t n)
+{
+  result_type const offset = min BOOST_PREVENT_MACRO_SUBSTITUTION ();
+  double const divisor = static_cast<double>((max BOOST_PREVENT_MACRO_SUBSTITUTION ()) - offset) + 1;
+  while (n) {
+    if(ptr_==buf_.end()) {
+      fill_buffer();
+      ptr_=buf_.begin();
+    }
+    std::size_t k = std::min<std::size_t>(n, buf_.end()-ptr_);
+    result_type const* in = &*ptr_;
+    for (std::size_t i = 0; i < k; ++i)
+      out[i] = static_cast<double>(in[i] - offset) / divisor;
+    ptr_ += k;
+    out += k;
+    n -= k;
+  }
+}
+
 /// a concrete implementation of a buffered random number generator
 /// \param RNG the type of random number generator
 template <class RNG> class buffered_rng : public buffered_rng_base
@@ -202,13 +258,7 @@ void buffered_rng<RNG>::write_all(std::ostream& os) const
 template <class RNG>
 void buffered_rng<RNG>::fill_buffer()
 {
-  // std::generate(buf_.begin(),buf_.end(),gen_);
-  std::vector<result_type>::iterator xx = buf_.begin();
-  while (xx != buf_.end())
-  {
-    *xx = rng_();
-    ++xx;
-  }
+  generate_block(rng_, &buf_[0], &buf_[0] + buf_.size());
 }
 
 } // end namespace
@@ -0,0 +1,190 @@
+/*****************************************************************************
+*
+* ALPS Project: Algorithms and Libraries for Physics Simulations
+*
+* ALPS Libraries
+*
+* Copyright (C) 1994-2013 by Matthias Troyer <troyer@itp.phys.ethz.ch>,
+*                            Synge Todo <wistaria@comp-phys.org>
+*
+* This software is part of the ALPS libraries, published under the ALPS
+* Library License; you can use, redistribute it and/or modify it under
+* the terms of the license, either version 1 or (at your option) any later
+* version.
+*
+* You should have received a copy of the ALPS Library License along with
+* the ALPS Libraries; see the file LICENSE.txt. If not, the license is also
+* available from http://alps.comp-phys.org/.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+* SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+* FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*
+*****************************************************************************/
+
+/* $Id$ */
+
+/// \file philox.h
+/// \brief the counter-based Philox4x32-10 random number generator
+
+#ifndef ALPS_RANDOM_PHILOX_H
+#define ALPS_RANDOM_PHILOX_H
+
+#include <boost/cstdint.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <iostream>
+#include <stdexcept>
+
+namespace alps {
+
+/// \brief the Philox4x32-10 generator of Salmon, Moraes, Dror and Shaw (SC'11)
+///
+/// Each block of four numbers is a keyed bijection of a 64-bit counter,
+/// so that blocks do not depend on each other. generate() therefore fills
+/// a range in a loop without loop-carried dependencies, which the compiler
+/// can vectorize, and gives the same numbers as successive calls of
+/// operator().
+class philox4x32
+{
+public:
+  typedef boost::uint32_t result_type;
+
+  BOOST_STATIC_CONSTANT(bool, has_fixed_range = false);
+  BOOST_STATIC_CONSTANT(boost::uint32_t, default_seed = 5489u);
+
+  philox4x32() { seed(); }
+  explicit philox4x32(boost::uint32_t s) { seed(s); }
+  template <class IT>
+  philox4x32(IT& first, IT last) { seed(first, last); }
+
+  void seed() { seed(default_seed); }
+  void seed(boost::uint32_t s) { set_key(s, 0); }
+  /// takes the two words of the key from a sequence
+  template <class IT>
+  void seed(IT& first, IT last)
+  {
+    boost::uint32_t k[2];
+    for (int j = 0; j < 2; ++j) {
+      if (first == last)
+        boost::throw_exception(std::invalid_argument("philox4x32::seed"));
+      k[j] = static_cast<boost::uint32_t>(*first++);
+    }
+    set_key(k[0], k[1]);
+  }
+
+  result_type min BOOST_PREVENT_MACRO_SUBSTITUTION () const { return 0; }
+  result_type max BOOST_PREVENT_MACRO_SUBSTITUTION () const { return 0xffffffffu; }
+
+  result_type operator()()
+  {
+    if (index_ == 4) {
+      block(counter_++, out_);
+      index_ = 0;
+    }
+    return out_[index_++];
+  }
+
+  /// fills [first, last) with the next last-first numbers of the sequence
+  void generate(result_type* first, result_type* last)
+  {
+    while (index_ < 4 && first != last) *first++ = out_[index_++];
+    std::size_t const n = (last - first) / 4;
+    boost::uint64_t const c = counter_;
+    for (std::size_t b = 0; b < n; ++b)
+      block(c + b, first + 4 * b);
+    counter_ += n;
+    first += 4 * n;
+    while (first != last) *first++ = (*this)();
+  }
+
+  void write(std::ostream& os) const
+  {
+    os << key_[0] << ' ' << key_[1] << ' ' << counter_ << ' ' << index_;
+  }
+  void read(std::istream& is)
+  {
+    is >> key_[0] >> key_[1] >> counter_ >> index_;
+    if (index_ < 4) block(counter_ - 1, out_);
+  }
+
+  friend bool operator==(philox4x32 const& x, philox4x32 const& y)
+  {
+    return x.key_[0] == y.key_[0] && x.key_[1] == y.key_[1] && x.counter_ == y.counter_ &&
+      x.index_ == y.index_;
+  }
+  friend bool operator!=(philox4x32 const& x, philox4x32 const& y) { return !(x == y); }
+
+private:
+  void set_key(boost::uint32_t k0, boost::uint32_t k1)
+  {
+    key_[0] = k0;
+    key_[1] = k1;
+    counter_ = 0;
+    index_ = 4;
+  }
+
+  /// the ten rounds of Philox4x32 applied to the counter c
+  void block(boost::uint64_t c, result_type* out) const
+  {
+    boost::uint32_t x0 = static_cast<boost::uint32_t>(c);
+    boost::uint32_t x1 = static_cast<boost::uint32_t>(c >> 32);
+    boost::uint32_t x2 = 0;
+    boost::uint32_t x3 = 0;
+    boost::uint32_t k0 = key_[0];
+    boost::uint32_t k1 = key_[1];
+    for (int r = 0; r < 10; ++r) {
+      boost::uint64_t p0 = boost::uint64_t(0xD2511F53u) * x0;
+      boost::uint64_t p1 = boost::uint64_t(0xCD9E8D57u) * x2;
+      boost::uint32_t y0 = static_cast<boost::uint32_t>(p1 >> 32) ^ x1 ^ k0;
+      boost::uint32_t y1 = static_cast<boost::uint32_t>(p1);
+      boost::uint32_t y2 = static_cast<boost::uint32_t>(p0 >> 32) ^ x3 ^ k1;
+      boost::uint32_t y3 = static_cast<boost::uint32_t>(p0);
+      x0 = y0; x1 = y1; x2 = y2; x3 = y3;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+    out[0] = x0;
+    out[1] = x1;
+    out[2] = x2;
+    out[3] = x3;
+  }
+
+  boost::uint32_t key_[2];
+  boost::uint64_t counter_; // counter of the next block
+  unsigned int index_;      // next unused number in out_, 4 if none is left
+  result_type out_[4];
+};
+
+/// fills a range from a Philox generator block by block
+/// \sa buffered_rng
+inline void generate_block(philox4x32& rng, boost::uint32_t* first, boost::uint32_t* last)
+{
+  rng.generate(first, last);
+}
+
+} // end namespace alps
+
+#ifndef BOOST_NO_OPERATORS_IN_NAMESPACE
+namespace alps {
+#endif
+
+inline std::ostream& operator<<(std::ostream& os, const alps::philox4x32& r) {
+  r.write(os);
+  return os;
+}
+
+inline std::istream& operator>>(std::istream& is, alps::philox4x32& r) {
+  r.read(is);
+  return is;
+}
+
+#ifndef BOOST_NO_OPERATORS_IN_NAMESPACE
+} // end namespace alps
+#endif
+
+#endif // ALPS_RANDOM_PHILOX_H
@@ -52,9 +52,10 @@ public:
 
 /// \brief a factory to create random number generators from their name
 /// 
-/// currently the folloowing two boost generators can be created from their name
+/// currently the following generators can be created from their name
 /// - lagged_fibonacci607
 /// - mt19937
+/// - philox4x32
 extern RNGFactory rng_factory;
 
 } // end namespace
@@ -51,6 +51,7 @@ public:
   typedef boost::numeric::ublas::mapped_vector_of_mapped_vector<T, boost::numeric::ublas::row_major>  operator_matrix_type;
   
   DiagTask (const ProcessList& where , const boost::filesystem::path& p,bool delay_construct=false);
+  DiagTask (const ProcessList& where , const Parameters& p,bool delay_construct=false);
 
   void dostep() { boost::throw_exception(std::logic_error("Cannot call dostep on the base class DiagTask")); }
 
@@ -88,6 +89,20 @@ DiagTask<T,G>::DiagTask(const ProcessList& where , const boost::filesystem::path
 }
 
 
+template <class T, class G>
+DiagTask<T,G>::DiagTask(const ProcessList& where , const Parameters& p, bool delay_construct) 
+    : scheduler::Task(where,p)
+    , graph_helper<G>(this->get_parameters())
+    , model_helper<>(this->get_parameters())
+    , MeasurementOperators(this->get_parameters())
+    , print_vectors_(this->get_parameters().value_or_default("PRINT_EIGENVECTORS",false))
+    , read_hdf5_(false)
+{
+  if (!delay_construct)
+    this->construct();
+}
+
+
 template <class T, class G>
 void DiagTask<T,G>::load(hdf5::archive & ar) {
   scheduler::Task::load(ar);
@@ -0,0 +1,142 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                 *
+ * ALPS Project: Algorithms and Libraries for Physics Simulations                  *
+ *                                                                                 *
+ * ALPS Libraries                                                                  *
+ *                                                                                 *
+ * Copyright (C) 2011 - 2012 by Lukas Gamper <gamperl@gmail.com>                   *
+ *                              Andreas Hehn <hehn@phys.ethz.ch>                   *
+ *                                                                                 *
+ * This software is part of the ALPS libraries, published under the ALPS           *
+ * Library License; you can use, redistribute it and/or modify it under            *
+ * the terms of the license, either version 1 or (at your option) any later        *
+ * version.                                                                        *
+ *                                                                                 *
+ * You should have received a copy of the ALPS Library License along with          *
+ * the ALPS Libraries; see the file LICENSE.txt. If not, the license is also       *
+ * available from http://alps.comp-phys.org/.                                      *
+ *                                                                                 *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,        *
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT       *
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE       *
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,     *
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER     *
+ * DEALINGS IN THE SOFTWARE.                                                       *
+ *                                                                                 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <alps/graph/lattice_constant_cache.hpp>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/graph/adjacency_list.hpp>
+
+#include <iostream>
+
+// Checks that lattice_constant_cache returns the same values as lattice_constant, both when computing
+// and after reloading the file, and that the cached values of one lattice or cell are not used for another.
+// The graph with 9 vertices needs bit indices of 32 and above in the embedding set.
+// The lattice key is printed since it has to be the same on every platform.
+
+typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> graph_type;
+
+struct lattice {
+    lattice(std::string const & name, unsigned int side_length)
+    {
+        std::ifstream in("../../lib/xml/lattices.xml");
+        alps::Parameters parm;
+        parm["LATTICE"] = name;
+        parm["L"] = side_length;
+        helper.reset(new alps::graph_helper<>(in, parm));
+    }
+    boost::shared_ptr<alps::graph_helper<> > helper;
+};
+
+int run(
+      std::string const & title
+    , alps::graph::lattice_constant_cache & cache
+    , std::vector<graph_type> const & g
+    , alps::graph_helper<> const & lattice
+    , std::vector<int> const & offset
+) {
+    int success = 0;
+    std::size_t const hits = cache.hits();
+    std::size_t const misses = cache.misses();
+    std::string const key = cache.key_for(lattice.graph(), lattice.lattice(), alps::cell(offset, lattice.lattice()));
+    std::cout << title << ":";
+    for (std::vector<graph_type>::const_iterator it = g.begin(); it != g.end(); ++it) {
+        std::size_t const cached = cache(*it, key, lattice.graph(), lattice.lattice(), alps::cell(offset, lattice.lattice()));
+        std::size_t const lc = alps::graph::lattice_constant(*it, lattice.graph(), lattice.lattice(), alps::cell(offset, lattice.lattice()));
+        std::cout << " " << cached;
+        if (cached != lc) {
+            std::cout << " (ERROR: lattice_constant gives " << lc << ")";
+            success = -1;
+        }
+    }
+    std::cout << "; hits = " << cache.hits() - hits << ", misses = " << cache.misses() - misses << std::endl;
+    return success;
+}
+
+int main() {
+    std::string const filename = "lattice_constant_cache_test.txt";
+    boost::filesystem::remove(filename);
+
+    std::vector<graph_type> g;
+
+    //  0---1
+    g.push_back(graph_type());
+    add_edge(0, 1, g.back());
+
+    //  0---1
+    //  |   |
+    //  2---3
+    g.push_back(graph_type());
+    add_edge(0, 1, g.back());
+    add_edge(1, 3, g.back());
+    add_edge(3, 2, g.back());
+    add_edge(2, 0, g.back());
+
+    //           8
+    //           |
+    //           4
+    //           |
+    //   6---2---0---1---5
+    //           |
+    //           3
+    //           |
+    //           7
+    g.push_back(graph_type());
+    add_edge(0, 1, g.back());
+    add_edge(0, 2, g.back());
+    add_edge(0, 3, g.back());
+    add_edge(0, 4, g.back());
+    add_edge(1, 5, g.back());
+    add_edge(2, 6, g.back());
+    add_edge(3, 7, g.back());
+    add_edge(4, 8, g.back());
+
+    lattice periodic("square lattice", 20);
+    lattice open("open square lattice", 20);
+    std::vector<int> center(2, 10);
+    std::vector<int> corner(2, 0);
+
+    int success = 0;
+    // the key is written to the cache file and must not depend on the platform
+    std::cout << "key: " << alps::graph::lattice_constant_cache::key_for(periodic.helper->graph(), periodic.helper->lattice(), alps::cell(center, periodic.helper->lattice())) << std::endl;
+    {
+        alps::graph::lattice_constant_cache cache(filename);
+        success |= run("periodic, center", cache, g, *periodic.helper, center);
+        success |= run("periodic, center", cache, g, *periodic.helper, center);
+        success |= run("open, center", cache, g, *open.helper, center);
+        success |= run("open, corner", cache, g, *open.helper, corner);
+    }
+    {
+        alps::graph::lattice_constant_cache cache(filename);
+        std::cout << "reloaded " << cache.size() << " lattice constants" << std::endl;
+        success |= run("periodic, center", cache, g, *periodic.helper, center);
+        success |= run("open, center", cache, g, *open.helper, center);
+        success |= run("open, corner", cache, g, *open.helper, corner);
+    }
+    boost::filesystem::remove(filename);
+    return success;
+}
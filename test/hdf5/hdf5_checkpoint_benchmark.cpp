@@ -0,0 +1,89 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                                 *
+ * ALPS Project: Algorithms and Libraries for Physics Simulations                  *
+ *                                                                                 *
+ * ALPS Libraries                                                                  *
+ *                                                                                 *
+ * Copyright (C) 2010 - 2013 by Lukas Gamper <gamperl@gmail.com>                   *
+ *                                                                                 *
+ * This software is part of the ALPS libraries, published under the ALPS           *
+ * Library License; you can use, redistribute it and/or modify it under            *
+ * the terms of the license, either version 1 or (at your option) any later        *
+ * version.                                                                        *
+ *                                                                                 *
+ * You should have received a copy of the ALPS Library License along with          *
+ * the ALPS Libraries; see the file LICENSE.txt. If not, the license is also       *
+ * available from http://alps.comp-phys.org/.                                      *
+ *                                                                                 *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,        *
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT       *
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE       *
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,     *
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER     *
+ * DEALINGS IN THE SOFTWARE.                                                       *
+ *                                                                                 *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+// Measures the checkpoint throughput if several threads write their own
+// checkpoint file at the same time, as the clones of a parapack worker do.
+// Each checkpoint replaces the file and stores a number of observables.
+//
+// usage: hdf5_checkpoint_benchmark [max threads] [checkpoints per thread] [doubles per observable]
+
+#include <alps/hdf5.hpp>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+#include <iostream>
+#include <vector>
+
+std::size_t const observables = 16;
+
+struct writer {
+    writer(unsigned id, unsigned count, std::size_t size)
+        : id_(id), count_(count), size_(size)
+    {}
+
+    void operator()() const {
+        std::string filename = "checkpoint." + boost::lexical_cast<std::string>(id_) + ".h5";
+        std::vector<double> data(size_);
+        for (unsigned n = 0; n < count_; ++n) {
+            for (std::size_t i = 0; i < size_; ++i)
+                data[i] = id_ + n + 1. / (1. + i);
+            alps::hdf5::archive ar(filename, "w");
+            ar["/parameters/SWEEPS"] << n;
+            for (std::size_t i = 0; i < observables; ++i)
+                ar["/simulation/results/O" + boost::lexical_cast<std::string>(i) + "/mean/value"] << data;
+        }
+        boost::filesystem::remove(filename);
+    }
+
+    unsigned id_;
+    unsigned count_;
+    std::size_t size_;
+};
+
+int main(int argc, char** argv) {
+    unsigned max_threads = argc > 1 ? boost::lexical_cast<unsigned>(argv[1]) : std::max(1u, boost::thread::hardware_concurrency());
+    unsigned count = argc > 2 ? boost::lexical_cast<unsigned>(argv[2]) : 20;
+    std::size_t size = argc > 3 ? boost::lexical_cast<std::size_t>(argv[3]) : 1 << 14;
+    double megabytes = observables * size * sizeof(double) / 1048576.;
+    std::cout << "checkpoint size: " << megabytes << " MB" << std::endl;
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+        boost::thread_group group;
+        for (unsigned i = 0; i < threads; ++i)
+            group.create_thread(writer(i, count, size));
+        group.join_all();
+        double seconds = (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() * 1e-6;
+        std::cout << "threads: " << threads
+                  << ", checkpoints/s: " << threads * count / seconds
+                  << ", MB/s: " << threads * count * megabytes / seconds
+                  << std::endl;
+    }
+    return EXIT_SUCCESS;
+}